@@ -4,15 +4,28 @@
 
 #include "EditorAssetLibrary.h"
 #include "SlateOptMacros.h"
+#include "UPActorRelabeler.h"
+#include "UPAssetQuery.h"
 #include "UPBulkRenameSettings.h"
 #include "UPBulkRenameUtility.h"
 #include "UPPerforceConnection.h"
-#include "AssetRegistry/AssetRegistryModule.h"
+#include "UPRenameExecutor.h"
+#include "UPRenamePlan.h"
+#include "AssetRegistry/IAssetRegistry.h"
 #include "Widgets/Input/SNumericEntryBox.h"
 #include "UPBulkRenameStyle.h"
+#include "Algo/SortBy.h"
+#include "Algo/StableSort.h"
+#include "Misc/CoreDelegates.h"
+#include "Misc/PackageName.h"
+#include "Misc/Paths.h"
+#include "Widgets/Images/SThrobber.h"
+#include "Widgets/Input/SSearchBox.h"
 #include "Widgets/Layout/SWidgetSwitcher.h"
-#include "Widgets/Text/SRichTextBlock.h"
-#include <filesystem>
+#include "Widgets/Views/SExpanderArrow.h"
+#include "WorldPartition/WorldPartition.h"
+#include "WorldPartition/WorldPartitionActorDescInstance.h"
+#include "WorldPartition/WorldPartitionHelpers.h"
 
 #include "Developer/SourceControl/Private/SourceControlModule.h"
 
@@ -23,8 +36,7 @@ BEGIN_SLATE_FUNCTION_BUILD_OPTIMIZATION
 
 void FRenameActionData::CheckNewPathDuplicated()
 {
-	std::filesystem::path SysPath = std::filesystem::path(TCHAR_TO_ANSI(*UUPBulkRenameUtility::MakeSysPath(GetFinalPath())));
-	IsNewPathDuplicated = std::filesystem::exists(SysPath);
+	IsNewPathDuplicated = FPaths::FileExists(UUPBulkRenameUtility::MakeSysPath(GetFinalPath()));
 }
 
 FString FRenameActionData::GetFinalPath()
@@ -43,11 +55,119 @@ FString FRenameActionData::GetFinalPath()
 	return Left + "/" + TempFinalPath + "." + TempFinalPath;
 }
 
+void FRenameActionData::RefreshActorLabel(const FString& NewLabel)
+{
+	if (TempFinalPath == OriginalFullPath)
+	{
+		TempFinalPath = NewLabel;
+	}
+	OriginalFullPath = NewLabel;
+	UpdateDisplayText();
+	SyncLabelIndex();
+}
+
+void FRenameActionData::UpdateDisplayText()
+{
+	if (IsActor() || *IsFolder)
+	{
+		OldNameText = FText::FromString(OriginalFullPath);
+		OldPathText = OldNameText;
+		return;
+	}
+	FString OutRight, OutLeft;
+	OriginalFullPath.Split(TEXT("."), &OutLeft, &OutRight, ESearchCase::IgnoreCase, ESearchDir::FromEnd);
+	OldNameText = FText::FromString(OutRight);
+	OldPathText = FText::FromString(OutLeft);
+	Folder = FPackageName::GetLongPackagePath(OutLeft);
+}
+
+namespace
+{
+	int32 CategoryIndex(uint8 Category)
+	{
+		return FMath::FloorLog2(Category);
+	}
+
+	/**
+	 * Characters trimmed off the start and end of a name, one rule for ApplyOperations and its preview.
+	 * Each end keeps at least one character, unless both ends together cover the whole name.
+	 * @return false when the name is trimmed to nothing
+	 */
+	bool TrimName(int32 Len, int32 RemoveAtBegin, int32 RemoveAtEnd, int32& OutHead, int32& OutTail)
+	{
+		if (RemoveAtBegin && RemoveAtEnd && RemoveAtBegin + RemoveAtEnd >= Len)
+		{
+			OutHead = Len;
+			OutTail = 0;
+			return false;
+		}
+		OutHead = FMath::Clamp(RemoveAtBegin, 0, FMath::Max(Len - 1, 0));
+		OutTail = FMath::Clamp(RemoveAtEnd, 0, FMath::Max(Len - OutHead - 1, 0));
+		return true;
+	}
+}
+
+FText FRenameActionData::GetGroupText() const
+{
+	const int32 NumRows = GroupRows.Num();
+	const int32 NumToRename = GroupCounts[CategoryIndex(ERowFilter::Valid)];
+	const int32 NumErrors = GroupCounts[CategoryIndex(ERowFilter::InValid)] + GroupCounts[CategoryIndex(ERowFilter::Duplicated)];
+	FString Text = FString::Printf(TEXT("%s/: %d assets"), *OriginalFullPath, NumRows);
+	if (NumToRename)
+		Text += FString::Printf(TEXT(", %d to rename"), NumToRename);
+	if (NumErrors)
+		Text += FString::Printf(TEXT(", %d errors"), NumErrors);
+	return FText::FromString(Text);
+}
+
+const FSlateBrush* FRenameActionData::GetGroupStatusIcon() const
+{
+	if (GroupCounts[CategoryIndex(ERowFilter::InValid)] || GroupCounts[CategoryIndex(ERowFilter::Duplicated)])
+		return FAppStyle::GetBrush("Icons.ErrorWithColor");
+	if (GroupCounts[CategoryIndex(ERowFilter::Valid)])
+		return FAppStyle::GetBrush("Icons.SuccessWithColor");
+	return FAppStyle::GetBrush("Icons.WarningWithColor");
+}
+
+const FText& FRenameActionData::GetOldText() const
+{
+	return ShouldShowPath && *ShouldShowPath ? OldPathText : OldNameText;
+}
+
+const FText& FRenameActionData::GetNewText() const
+{
+	if (!NewTextSource.Equals(TempFinalPath, ESearchCase::CaseSensitive))
+	{
+		NewTextSource = TempFinalPath;
+		NewText = FText::FromString(TempFinalPath);
+	}
+	return NewText;
+}
+
+void FRenameActionData::SyncLabelIndex()
+{
+	if (LabelIndex && !IndexedLabel.Equals(TempFinalPath, ESearchCase::CaseSensitive))
+	{
+		LabelIndex->Remove(IndexedLabel);
+		LabelIndex->Add(TempFinalPath);
+		IndexedLabel = TempFinalPath;
+	}
+}
+
+void FUPActorLabelIndex::Remove(const FString& Label)
+{
+	if (int32* Count = Counts.Find(Label); Count && --*Count <= 0)
+	{
+		Counts.Remove(Label);
+	}
+}
+
 void FRenameActionData::ResetFinalFullPath()
 {
-	if (TargetActor)
+	if (IsActor())
 	{
-		TempFinalPath = TargetActor->GetActorLabel();
+		TempFinalPath = GetActorLabel();
+		SyncLabelIndex();
 		return;
 	}
 	if (*IsFolder)
@@ -70,10 +190,12 @@ void FRenameActionData::ResetFinalFullPath()
 
 ENewNameValidStatus::Type FRenameActionData::GetNewNameStatus() const
 {
-	if (TargetActor)
+	if (IsActor())
 	{
-		return TargetActor->GetActorLabel() == TempFinalPath?
-			ENewNameValidStatus::NoChange : ENewNameValidStatus::Valid;
+		if (GetActorLabel() == TempFinalPath)
+			return ENewNameValidStatus::NoChange;
+		return LabelIndex && LabelIndex->IsDuplicated(TempFinalPath) ?
+			ENewNameValidStatus::LabelInUse : ENewNameValidStatus::Valid;
 	}
 	if (TempFinalPath.IsEmpty()) return ENewNameValidStatus::InValid;	
 	if (IsNewPathDuplicated) return ENewNameValidStatus::Duplicated;
@@ -97,12 +219,28 @@ ENewNameValidStatus::Type FRenameActionData::GetNewNameStatus() const
 	return ENewNameValidStatus::Valid;
 }
 
+uint8 FRenameActionData::GetFilterCategory() const
+{
+	switch (GetNewNameStatus())
+	{
+	case ENewNameValidStatus::NoChange:
+		return ERowFilter::NoChange;
+	case ENewNameValidStatus::InValid:
+		return ERowFilter::InValid;
+	case ENewNameValidStatus::Duplicated:
+		return ERowFilter::Duplicated;
+	default:
+		return ERowFilter::Valid;
+	}
+}
+
 const FSlateBrush* FRenameActionData::GetStatusIcon() const
 {
 	switch (GetNewNameStatus()) {
 	case ENewNameValidStatus::Valid:
 		return FAppStyle::GetBrush("Icons.SuccessWithColor");
 	case ENewNameValidStatus::NoChange:
+	case ENewNameValidStatus::LabelInUse:
 		return FAppStyle::GetBrush("Icons.WarningWithColor");
 	default: ;
 		return FAppStyle::GetBrush("Icons.ErrorWithColor");
@@ -114,26 +252,40 @@ void SRenameRow::Construct(const FArguments& InArgs, TSharedPtr<FRenameActionDat
 {
 	MyData = InData;
 	ParentDialog = InParentDialog;
-	ParentDialog->StartEdit.AddLambda([this]()
-	{
-		NewPathSwitcher->SetActiveWidgetIndex(1);
-	});
-	ParentDialog->EndEdit.AddLambda([this]()
-	{
-		NewPathSwitcher->SetActiveWidgetIndex(0);
-	});
-	
 	SMultiColumnTableRow<TSharedPtr<FRenameActionData>>::Construct(FSuperRowType::FArguments(), InOwnerTableView);
 }
 
 TSharedRef<SWidget> SRenameRow::GenerateWidgetForColumn(const FName& InColumnName)
 {
-	FString OutRight, OutLeft;
-	MyData->OriginalFullPath.Split(TEXT("."), &OutLeft, &OutRight, ESearchCase::IgnoreCase, ESearchDir::FromEnd);
-	FText OriginAsset = FText::FromString(OutRight);
-	FText OriginPath = FText::FromString(OutLeft);
-	MyData->ResetFinalFullPath();
-	
+	if (MyData->bIsGroup)
+	{
+		if (InColumnName == FName("Old"))
+		{
+			return SNew(SHorizontalBox)
+			+SHorizontalBox::Slot()
+			.AutoWidth()
+			[
+				SNew(SExpanderArrow, SharedThis(this))
+			]
+			+SHorizontalBox::Slot()
+			.FillWidth(1.f)
+			.VAlign(VAlign_Center)
+			[
+				SNew(STextBlock)
+				.Text_Lambda([this]() { return MyData->GetGroupText(); })
+			];
+		}
+		return SNew(SBox)
+		.HAlign(HAlign_Right)
+		.VAlign(VAlign_Center)
+		.Padding(3.f, 0.f)
+		[
+			SNew(SImage)
+			.Image_Lambda([this]() { return MyData->GetGroupStatusIcon(); })
+			.DesiredSizeOverride(FVector2D(16,16))
+		];
+	}
+
 	TSharedPtr<SWidget> RowWidget = SNullWidget::NullWidget;
 	if (InColumnName == FName("Old"))
 	{
@@ -142,15 +294,26 @@ TSharedRef<SWidget> SRenameRow::GenerateWidgetForColumn(const FName& InColumnNam
 		.Padding(FMargin(10, 1, 0, 1))
 		[
 			SNew(STextBlock)
-			.Text_Lambda([=, this]()
+			.Text_Lambda([this]()
 			{
-				if (MyData->TargetActor)
-					return FText::FromString(MyData->TargetActor->GetActorLabel());
-				if (ParentDialog->IsFolder)
-					return FText::FromString(MyData->OriginalFullPath);
-				return ParentDialog->ShouldEditPath? OriginPath : OriginAsset;
+				return MyData->GetOldText();
 			})
 		];
+		if (ParentDialog->IsGroupingByFolder())
+		{
+			// indents the row under its group
+			RowWidget = SNew(SHorizontalBox)
+			+SHorizontalBox::Slot()
+			.AutoWidth()
+			[
+				SNew(SExpanderArrow, SharedThis(this))
+			]
+			+SHorizontalBox::Slot()
+			.FillWidth(1.f)
+			[
+				RowWidget.ToSharedRef()
+			];
+		}
 	}
 	else if (InColumnName == FName("New"))
 	{
@@ -159,7 +322,11 @@ TSharedRef<SWidget> SRenameRow::GenerateWidgetForColumn(const FName& InColumnNam
 		.HAlign(HAlign_Fill)
 		.Padding(FMargin(10, 1, 0, 1))
 		[
-			SAssignNew(NewPathSwitcher, SWidgetSwitcher)
+			SNew(SWidgetSwitcher)
+			.WidgetIndex_Lambda([this]()
+			{
+				return ParentDialog->IsEditingOperations() ? 1 : 0;
+			})
 			+SWidgetSwitcher::Slot()
 			[
 				SNew(SHorizontalBox)
@@ -169,13 +336,16 @@ TSharedRef<SWidget> SRenameRow::GenerateWidgetForColumn(const FName& InColumnNam
 					SNew(SEditableTextBox)
 					.Text_Lambda([this]()
 					{
-						return FText::FromString(MyData->TempFinalPath);
+						return MyData->GetNewText();
 					})
 					.OnTextChanged_Lambda([this](const FText& T)
 					{
 						MyData->TempFinalPath = T.ToString();
-						if (!MyData->TargetActor)
+						if (!MyData->IsActor())
 							MyData->CheckNewPathDuplicated();
+						else
+							MyData->SyncLabelIndex();
+						ParentDialog->UpdateRowIndex(MyData);
 					})
 				]
 				+SHorizontalBox::Slot()
@@ -197,6 +367,8 @@ TSharedRef<SWidget> SRenameRow::GenerateWidgetForColumn(const FName& InColumnNam
 							return FText::FromString("Error! New name contains invalid character or it's and empty name");
 						case ENewNameValidStatus::Duplicated:
 							return FText::FromString("Error! Asset the same already exists!");
+						case ENewNameValidStatus::LabelInUse:
+							return FText::FromString("Another actor of the level has the same label.");
 						}
 						return FText::GetEmpty();
 					})
@@ -209,10 +381,8 @@ TSharedRef<SWidget> SRenameRow::GenerateWidgetForColumn(const FName& InColumnNam
 			]
 			+ SWidgetSwitcher::Slot()
 			[
-				SNew(SRichTextBlock)
-				.Text_Lambda([this] { return FText::FromString(MyData->RenamingPath);})
-				.DecoratorStyleSet(&FUPBulkRenameStyle::Get())
-				.TextStyle(FUPBulkRenameStyle::Get(), "Default")
+				SNew(SUPPreviewText)
+				.Preview(&MyData->Preview)
 			]
 		];
 	}
@@ -233,10 +403,36 @@ void SUPDialog::Construct(const FArguments& InArgs, const TArray<FString>& InSel
 		RenameData.Add(MakeShareable(new FRenameActionData(Path, &IsFolder, &ShouldEditPath)));
 	}
 
+	WatchAssetRegistryScan(InSelectedPaths);
 	CreateDialogContent();
 
 }
 
+void SUPDialog::Construct(const FArguments& InArgs, const FUPAssetQuery& InQuery)
+{
+	FSourceControlModule& SourceControlModule = FSourceControlModule::Get();
+	CurrentSourceControlProvider = SourceControlModule.GetProvider().GetName();
+	bApplyPerforceFix = GetMutableDefault<UUPBulkRenameSettings>()->bAllowPerforceFix &&
+		CurrentSourceControlProvider == FName("Perforce");
+	RenameData.Empty();
+	PendingQuery = InQuery;
+	bStreamingRows = true;
+	bGroupByFolder = true;
+	AssetRegistryProgress = FText::FromString("Querying asset registry...");
+
+	TArray<FString> QueryPaths;
+	for (const FName& Path : InQuery.PackagePaths)
+	{
+		QueryPaths.Add(Path.ToString());
+	}
+	WatchAssetRegistryScan(QueryPaths);
+	CreateDialogContent();
+	if (!bWaitingForAssetRegistry)
+	{
+		RunAssetQuery();
+	}
+}
+
 void SUPDialog::Construct(const FArguments& InArgs, const TArray<AActor*>& InSelectedActors)
 {
 	RenameData.Empty();
@@ -245,13 +441,35 @@ void SUPDialog::Construct(const FArguments& InArgs, const TArray<AActor*>& InSel
 		RenameData.Add(MakeShareable(new FRenameActionData(Actor)));
 	}
 	IsActor = true;
+	IndexActorRows();
+	CreateDialogContent();
+}
+
+void SUPDialog::Construct(const FArguments& InArgs, UWorld* InWorld)
+{
+	RenameData.Empty();
+	PartitionedWorld = InWorld;
+	if (UWorldPartition* WorldPartition = InWorld ? InWorld->GetWorldPartition() : nullptr)
+	{
+		FWorldPartitionHelpers::ForEachActorDescInstance(WorldPartition, [this](const FWorldPartitionActorDescInstance* ActorDesc)
+		{
+			const FName Label = ActorDesc->GetActorLabel();
+			RenameData.Add(MakeShareable(new FRenameActionData(ActorDesc->GetGuid(),
+				Label.IsNone() ? ActorDesc->GetActorName().ToString() : Label.ToString())));
+			return true;
+		});
+	}
+	IsActor = true;
+	IndexActorRows();
 	CreateDialogContent();
 }
 
 void SUPDialog::CreateDialogContent()
 {
+	CollapsedGroupChild = MakeShared<FRenameActionData>(FString());
+	AddRowsToIndex(0);
 	SAssignNew(ListWidget, STreeView<TSharedPtr<FRenameActionData>>)
-	.TreeItemsSource(&RenameData)
+	.TreeItemsSource(&VisibleRows)
 	.SelectionMode(ESelectionMode::Type::None)
 	.HeaderRow(
 		SNew(SHeaderRow)
@@ -260,20 +478,30 @@ void SUPDialog::CreateDialogContent()
 		.HeaderContentPadding(FMargin(10, 1, 0, 1))
 		.DefaultLabel(LOCTEXT("RowName1", "Old"))
 		.FillWidth(1.0)
+		.SortMode_Lambda([this]() { return SortColumn == FName("Old") ? SortMode : EColumnSortMode::None; })
+		.OnSort(this, &SUPDialog::OnSortColumn)
 
 		// New
 		+ SHeaderRow::Column(FName("New"))
 		.HeaderContentPadding(FMargin(10, 1, 0, 1))
 		.DefaultLabel(LOCTEXT("RowName2", "New"))
 		.FillWidth(1.0)
+		.SortMode_Lambda([this]() { return SortColumn == FName("New") ? SortMode : EColumnSortMode::None; })
+		.OnSort(this, &SUPDialog::OnSortColumn)
 
 	)
 	.OnGenerateRow_Lambda([this](TSharedPtr<FRenameActionData> InData, const TSharedRef<STableViewBase>& OutTable)
 	{
 		return SNew(SRenameRow, InData, OutTable, this);
 	})
-	.OnGetChildren_Lambda([](TSharedPtr<FRenameActionData> InItem, TArray<TSharedPtr<FRenameActionData>>& OutChildren)
+	.OnGetChildren_Lambda([this](TSharedPtr<FRenameActionData> InItem, TArray<TSharedPtr<FRenameActionData>>& OutChildren)
 	{
+		if (!InItem->bIsGroup || InItem->GroupRows.IsEmpty())
+			return;
+		if (ListWidget->IsItemExpanded(InItem))
+			OutChildren.Append(InItem->GroupRows);
+		else
+			OutChildren.Add(CollapsedGroupChild);
 	})
 	;
 
@@ -584,7 +812,72 @@ void SUPDialog::CreateDialogContent()
 		]
 	]
 	+ SVerticalBox::Slot()
+	.AutoHeight()
 	.Padding(0.f, 20.f, 0.f, 0.f)
+	[
+		SNew(SHorizontalBox)
+		+SHorizontalBox::Slot()
+		.FillWidth(1.f)
+		.VAlign(VAlign_Center)
+		[
+			SNew(SSearchBox)
+			.HintText(FText::FromString("Filter by old or new name"))
+			.OnTextChanged_Lambda([this](const FText& NewText)
+			{
+				FilterText = NewText.ToString();
+				RebuildVisibleRows();
+			})
+		]
+		+SHorizontalBox::Slot()
+		.AutoWidth()
+		.VAlign(VAlign_Center)
+		.Padding(6.f, 0.f, 0.f, 0.f)
+		[
+			SNew(SCheckBox)
+			.Visibility(IsActor || IsFolder ? EVisibility::Collapsed : EVisibility::Visible)
+			.ToolTipText(FText::FromString("Group assets by folder, a group lists its assets once expanded"))
+			.IsChecked_Lambda([this]()
+			{
+				return bGroupByFolder ? ECheckBoxState::Checked : ECheckBoxState::Unchecked;
+			})
+			.OnCheckStateChanged_Lambda([this](ECheckBoxState NewState)
+			{
+				bGroupByFolder = NewState == ECheckBoxState::Checked;
+				RebuildVisibleRows();
+				ListWidget->RebuildList();
+			})
+			[
+				SNew(STextBlock)
+				.Text(FText::FromString("Group by folder"))
+			]
+		]
+		+SHorizontalBox::Slot()
+		.AutoWidth()
+		.Padding(6.f, 0.f, 0.f, 0.f)
+		[
+			MakeStatusFilterToggle("Valid", ERowFilter::Valid)
+		]
+		+SHorizontalBox::Slot()
+		.AutoWidth()
+		.Padding(2.f, 0.f, 0.f, 0.f)
+		[
+			MakeStatusFilterToggle("Unchanged", ERowFilter::NoChange)
+		]
+		+SHorizontalBox::Slot()
+		.AutoWidth()
+		.Padding(2.f, 0.f, 0.f, 0.f)
+		[
+			MakeStatusFilterToggle("Invalid", ERowFilter::InValid)
+		]
+		+SHorizontalBox::Slot()
+		.AutoWidth()
+		.Padding(2.f, 0.f, 0.f, 0.f)
+		[
+			MakeStatusFilterToggle("Duplicated", ERowFilter::Duplicated)
+		]
+	]
+	+ SVerticalBox::Slot()
+	.Padding(0.f, 4.f, 0.f, 0.f)
 	.FillHeight(1.f)
 	[
 		SNew(SBox)
@@ -598,25 +891,6 @@ void SUPDialog::CreateDialogContent()
 		]
 	];
 	
-	// window construct
-	FString DialogTitle;
-	if (IsActor)
-	{
-		DialogTitle = "UP Bulk Rename on " + FString::FromInt(RenameData.Num()) + "actors" ;
-	} else if (IsFolder)
-	{
-		int N_Assets = 0;
-		for (auto Data : RenameData)
-		{
-			N_Assets += UEditorAssetLibrary::ListAssets(Data->OriginalFullPath).Num();
-		}
-		DialogTitle = "UP Bulk Rename on folders (" + FString::FromInt(N_Assets) + " assets)";
-	}
-	else
-	{
-		DialogTitle = "UP Bulk Rename on " + FString::FromInt(RenameData.Num()) + "assets" ;
-	}
-	
 	// SetSizingRule(ESizingRule::Autosized);
 	// // TitleBar
 	// bHasMaximizeButton = false;
@@ -624,7 +898,7 @@ void SUPDialog::CreateDialogContent()
 	// bHasCloseButton = true;
 
 	SWindow::Construct(SWindow::FArguments()
-	.Title(FText::FromString(DialogTitle))
+	.Title(MakeDialogTitle())
 	.SizingRule(ESizingRule::Autosized)
 	.SupportsMaximize(false)
 	.SupportsMinimize(false)
@@ -648,6 +922,31 @@ void SUPDialog::CreateDialogContent()
 			.HAlign(HAlign_Fill)
 			.AutoHeight()
 			.Padding(0.f, 2.f, 0.f, 0.f)
+			[
+				SNew(SHorizontalBox)
+				.Visibility_Lambda([this]()
+				{
+					return bWaitingForAssetRegistry || bStreamingRows ? EVisibility::Visible : EVisibility::Collapsed;
+				})
+				+SHorizontalBox::Slot()
+				.AutoWidth()
+				.VAlign(VAlign_Center)
+				.Padding(0.f, 0.f, 6.f, 0.f)
+				[
+					SNew(SThrobber)
+				]
+				+SHorizontalBox::Slot()
+				.FillWidth(1.f)
+				.VAlign(VAlign_Center)
+				[
+					SNew(STextBlock)
+					.Text_Lambda([this]() { return AssetRegistryProgress; })
+				]
+			]
+			+ SVerticalBox::Slot()
+			.HAlign(HAlign_Fill)
+			.AutoHeight()
+			.Padding(0.f, 2.f, 0.f, 0.f)
 			[
 				SNew(SHorizontalBox)
 				+SHorizontalBox::Slot()
@@ -711,6 +1010,347 @@ Set source control provider as perforce and Enable allow perforce fix!
 	]);
 }
 
+SUPDialog::~SUPDialog()
+{
+	FTSTicker::GetCoreTicker().RemoveTicker(QueryTickerHandle);
+	FCoreDelegates::OnActorLabelChanged.Remove(ActorLabelChangedHandle);
+	if (IAssetRegistry* AssetRegistry = IAssetRegistry::Get())
+	{
+		AssetRegistry->OnFileLoadProgressUpdated().Remove(FileLoadProgressHandle);
+		AssetRegistry->OnFilesLoaded().Remove(FilesLoadedHandle);
+	}
+}
+
+void SUPDialog::IndexActorRows()
+{
+	ActorRows.Reserve(RenameData.Num());
+	for (const TSharedPtr<FRenameActionData>& Data : RenameData)
+	{
+		ActorRows.Add(Data->ActorGuid, Data);
+	}
+	ActorLabelChangedHandle = FCoreDelegates::OnActorLabelChanged.AddSP(this, &SUPDialog::OnActorLabelChanged);
+	BuildLabelIndices();
+}
+
+void SUPDialog::BuildLabelIndices()
+{
+	const double StartTime = FPlatformTime::Seconds();
+	// descriptor rows already cover every actor of the world
+	if (PartitionedWorld.IsValid())
+	{
+		TSharedPtr<FUPActorLabelIndex> Index = MakeShared<FUPActorLabelIndex>();
+		Index->Reserve(RenameData.Num());
+		for (const TSharedPtr<FRenameActionData>& Data : RenameData)
+		{
+			Data->LabelIndex = Index;
+			Data->IndexedLabel = Data->TempFinalPath;
+			Index->Add(Data->TempFinalPath);
+		}
+		return;
+	}
+
+	TMap<const ULevel*, TSharedPtr<FUPActorLabelIndex>> LevelIndices;
+	for (const TSharedPtr<FRenameActionData>& Data : RenameData)
+	{
+		const ULevel* Level = Data->TargetActor->GetLevel();
+		TSharedPtr<FUPActorLabelIndex>& Index = LevelIndices.FindOrAdd(Level);
+		if (!Index)
+		{
+			// the rest of the level, once
+			Index = MakeShared<FUPActorLabelIndex>();
+			Index->Reserve(Level->Actors.Num());
+			for (const AActor* Actor : Level->Actors)
+			{
+				if (Actor && Actor->IsListedInSceneOutliner() && !ActorRows.Contains(Actor->GetActorGuid()))
+				{
+					const FString Label = Actor->GetActorLabel();
+					Index->Add(Label);
+					OutsideActorLabels.Add(Actor->GetActorGuid(), { Index, Label });
+				}
+			}
+		}
+		Data->LabelIndex = Index;
+		Data->IndexedLabel = Data->TempFinalPath;
+		Index->Add(Data->TempFinalPath);
+	}
+	UE_LOG(LogUPBulkRename, Verbose, TEXT("Indexed the labels of %d levels in %.3fs"), LevelIndices.Num(), FPlatformTime::Seconds() - StartTime);
+}
+
+void SUPDialog::OnActorLabelChanged(AActor* Actor)
+{
+	if (const TSharedPtr<FRenameActionData>* Data = ActorRows.Find(Actor->GetActorGuid()))
+	{
+		(*Data)->RefreshActorLabel(Actor->GetActorLabel());
+		UpdateRowIndex(*Data);
+	}
+	else if (TPair<TSharedPtr<FUPActorLabelIndex>, FString>* Outside = OutsideActorLabels.Find(Actor->GetActorGuid()))
+	{
+		// an actor without a row renamed elsewhere, rows read their status from the index when they paint
+		const FString OldLabel = MoveTemp(Outside->Value);
+		Outside->Value = Actor->GetActorLabel();
+		Outside->Key->Remove(OldLabel);
+		Outside->Key->Add(Outside->Value);
+	}
+}
+
+void SUPDialog::AddRowsToIndex(int32 FirstRow)
+{
+	SortedRows.Reserve(RenameData.Num());
+	for (int32 i = FirstRow; i < RenameData.Num(); i++)
+	{
+		const TSharedPtr<FRenameActionData>& Data = RenameData[i];
+		Data->SortRank = SortedRows.Add(Data);
+		Data->FilterCategory = Data->GetFilterCategory();
+		RowsByCategory.FindOrAdd(Data->FilterCategory).Add(Data);
+	}
+	bSortDirty |= SortMode != EColumnSortMode::None;
+	RebuildVisibleRows();
+}
+
+void SUPDialog::UpdateRowIndex(const TSharedPtr<FRenameActionData>& Data)
+{
+	const uint8 Category = Data->GetFilterCategory();
+	if (Category != Data->FilterCategory)
+	{
+		if (const TSharedPtr<FRenameActionData> Group = Data->Group.Pin())
+		{
+			Group->GroupCounts[CategoryIndex(Data->FilterCategory)]--;
+			Group->GroupCounts[CategoryIndex(Category)]++;
+		}
+		if (TSet<TSharedPtr<FRenameActionData>>* Rows = RowsByCategory.Find(Data->FilterCategory))
+		{
+			Rows->Remove(Data);
+		}
+		RowsByCategory.FindOrAdd(Category).Add(Data);
+		Data->FilterCategory = Category;
+	}
+}
+
+void SUPDialog::UpdateRowIndices()
+{
+	for (const TSharedPtr<FRenameActionData>& Data : RenameData)
+	{
+		UpdateRowIndex(Data);
+	}
+	// new names changed under a sort on them
+	bSortDirty |= SortColumn == FName("New") && SortMode != EColumnSortMode::None;
+	RebuildVisibleRows();
+}
+
+void SUPDialog::SortRows()
+{
+	SortedRows = RenameData;
+	if (SortMode != EColumnSortMode::None)
+	{
+		const bool bByNew = SortColumn == FName("New");
+		const bool bAscending = SortMode == EColumnSortMode::Ascending;
+		Algo::StableSort(SortedRows, [bByNew, bAscending](const TSharedPtr<FRenameActionData>& A, const TSharedPtr<FRenameActionData>& B)
+		{
+			const FString& KeyA = bByNew ? A->TempFinalPath : A->GetOldText().ToString();
+			const FString& KeyB = bByNew ? B->TempFinalPath : B->GetOldText().ToString();
+			return bAscending ? KeyA < KeyB : KeyB < KeyA;
+		});
+	}
+	for (int32 i = 0; i < SortedRows.Num(); i++)
+	{
+		SortedRows[i]->SortRank = i;
+	}
+	bSortDirty = false;
+}
+
+void SUPDialog::RebuildVisibleRows()
+{
+	if (bSortDirty)
+	{
+		SortRows();
+	}
+	VisibleRows.Reset();
+	if (StatusFilter == 0)
+	{
+		for (const TSharedPtr<FRenameActionData>& Data : SortedRows)
+		{
+			if (PassesTextFilter(*Data))
+				VisibleRows.Add(Data);
+		}
+	}
+	else
+	{
+		for (const TPair<uint8, TSet<TSharedPtr<FRenameActionData>>>& Category : RowsByCategory)
+		{
+			if (!(Category.Key & StatusFilter))
+				continue;
+			for (const TSharedPtr<FRenameActionData>& Data : Category.Value)
+			{
+				if (PassesTextFilter(*Data))
+					VisibleRows.Add(Data);
+			}
+		}
+		// only the matches are put back in sort order, by rank
+		Algo::SortBy(VisibleRows, [](const TSharedPtr<FRenameActionData>& Data) { return Data->SortRank; });
+	}
+	if (bGroupByFolder && !IsActor && !IsFolder)
+	{
+		GroupVisibleRows();
+	}
+	if (ListWidget)
+	{
+		ListWidget->RequestTreeRefresh();
+	}
+}
+
+void SUPDialog::GroupVisibleRows()
+{
+	for (const TPair<FString, TSharedPtr<FRenameActionData>>& GroupNode : GroupNodes)
+	{
+		for (const TSharedPtr<FRenameActionData>& Data : GroupNode.Value->GroupRows)
+		{
+			Data->Group.Reset();
+		}
+		GroupNode.Value->GroupRows.Reset();
+		FMemory::Memzero(GroupNode.Value->GroupCounts);
+	}
+
+	// group nodes are kept across rebuilds so they stay expanded
+	TArray<TSharedPtr<FRenameActionData>> Groups;
+	for (const TSharedPtr<FRenameActionData>& Data : VisibleRows)
+	{
+		TSharedPtr<FRenameActionData>& Group = GroupNodes.FindOrAdd(Data->Folder);
+		if (!Group)
+		{
+			Group = MakeShared<FRenameActionData>(Data->Folder);
+		}
+		if (Group->GroupRows.IsEmpty())
+		{
+			Groups.Add(Group);
+		}
+		Group->GroupRows.Add(Data);
+		Group->GroupCounts[CategoryIndex(Data->FilterCategory)]++;
+		Data->Group = Group;
+	}
+	Algo::SortBy(Groups, [](const TSharedPtr<FRenameActionData>& Group) -> const FString& { return Group->OriginalFullPath; });
+	VisibleRows = MoveTemp(Groups);
+}
+
+bool SUPDialog::PassesTextFilter(const FRenameActionData& Data) const
+{
+	return FilterText.IsEmpty() || Data.GetOldText().ToString().Contains(FilterText) || Data.TempFinalPath.Contains(FilterText);
+}
+
+void SUPDialog::OnSortColumn(EColumnSortPriority::Type SortPriority, const FName& ColumnName, EColumnSortMode::Type NewSortMode)
+{
+	SortColumn = ColumnName;
+	SortMode = NewSortMode;
+	bSortDirty = true;
+	RebuildVisibleRows();
+}
+
+TSharedRef<SWidget> SUPDialog::MakeStatusFilterToggle(const FString& Label, ERowFilter::Type Category)
+{
+	return SNew(SCheckBox)
+	.Style(FAppStyle::Get(), "ToggleButtonCheckbox")
+	.Padding(FMargin(6.f, 2.f))
+	.ToolTipText(FText::FromString("Show " + Label.ToLower() + " rows, status filters add up"))
+	.IsChecked_Lambda([this, Category]()
+	{
+		return StatusFilter & Category ? ECheckBoxState::Checked : ECheckBoxState::Unchecked;
+	})
+	.OnCheckStateChanged_Lambda([this, Category](ECheckBoxState NewState)
+	{
+		StatusFilter = static_cast<uint8>(NewState == ECheckBoxState::Checked ? StatusFilter | Category : StatusFilter & ~Category);
+		RebuildVisibleRows();
+	})
+	[
+		SNew(STextBlock)
+		.Text_Lambda([this, Label, Category]()
+		{
+			const TSet<TSharedPtr<FRenameActionData>>* Rows = RowsByCategory.Find(Category);
+			return FText::FromString(FString::Printf(TEXT("%s %d"), *Label, Rows ? Rows->Num() : 0));
+		})
+	];
+}
+
+FText SUPDialog::MakeDialogTitle() const
+{
+	FString DialogTitle;
+	if (IsActor)
+	{
+		DialogTitle = "UP Bulk Rename on " + FString::FromInt(RenameData.Num()) + "actors" ;
+	} else if (IsFolder)
+	{
+		if (bWaitingForAssetRegistry)
+		{
+			return FText::FromString("UP Bulk Rename on folders (scanning assets...)");
+		}
+		int N_Assets = 0;
+		for (auto Data : RenameData)
+		{
+			N_Assets += UEditorAssetLibrary::ListAssets(Data->OriginalFullPath).Num();
+		}
+		DialogTitle = "UP Bulk Rename on folders (" + FString::FromInt(N_Assets) + " assets)";
+	}
+	else
+	{
+		DialogTitle = "UP Bulk Rename on " + FString::FromInt(RenameData.Num()) + "assets" ;
+	}
+	return FText::FromString(DialogTitle);
+}
+
+void SUPDialog::WatchAssetRegistryScan(const TArray<FString>& InSelectedPaths)
+{
+	IAssetRegistry& AssetRegistry = IAssetRegistry::GetChecked();
+	if (!AssetRegistry.IsLoadingAssets())
+	{
+		return;
+	}
+	// a partially discovered registry gives wrong listings and referencers, only plan once it's done
+	bWaitingForAssetRegistry = true;
+	AssetRegistryProgress = FText::FromString("Waiting for asset registry scan...");
+	for (const FString& Path : InSelectedPaths)
+	{
+		// query roots are folders too
+		AssetRegistry.PrioritizeSearchPath(IsFolder || PendingQuery.IsSet() ? Path : FPaths::GetPath(Path));
+	}
+	FileLoadProgressHandle = AssetRegistry.OnFileLoadProgressUpdated().AddSP(this, &SUPDialog::OnAssetRegistryProgress);
+	FilesLoadedHandle = AssetRegistry.OnFilesLoaded().AddSP(this, &SUPDialog::OnAssetRegistryFilesLoaded);
+}
+
+void SUPDialog::OnAssetRegistryProgress(const IAssetRegistry::FFileLoadProgressUpdateData& ProgressData)
+{
+	if (ProgressData.bIsDiscoveringAssetFiles)
+	{
+		AssetRegistryProgress = FText::FromString(FString::Printf(TEXT("Discovering asset files... (%d found)"),
+			ProgressData.NumTotalAssets));
+		return;
+	}
+	AssetRegistryProgress = FText::FromString(FString::Printf(
+		TEXT("Scanning asset registry %d / %d, rename is disabled until it's done"),
+		ProgressData.NumAssetsProcessedByAssetRegistry, ProgressData.NumTotalAssets));
+}
+
+void SUPDialog::OnAssetRegistryFilesLoaded()
+{
+	IAssetRegistry& AssetRegistry = IAssetRegistry::GetChecked();
+	AssetRegistry.OnFileLoadProgressUpdated().Remove(FileLoadProgressHandle);
+	AssetRegistry.OnFilesLoaded().Remove(FilesLoadedHandle);
+	FileLoadProgressHandle.Reset();
+	FilesLoadedHandle.Reset();
+	bWaitingForAssetRegistry = false;
+
+	// resume the planning that depended on the registry
+	if (PendingQuery.IsSet())
+	{
+		RunAssetQuery();
+		return;
+	}
+	SetTitle(MakeDialogTitle());
+	for (auto Data : RenameData)
+	{
+		if (Data->GetNewNameStatus() != ENewNameValidStatus::NoChange)
+			Data->CheckNewPathDuplicated();
+	}
+	UpdateRowIndices();
+}
+
 void SUPDialog::Open(const TArray<FString>& InSelectedPaths, bool InIsFolder)
 {
 	FSlateApplication::Get().AddWindow(
@@ -718,6 +1358,48 @@ void SUPDialog::Open(const TArray<FString>& InSelectedPaths, bool InIsFolder)
 	);
 }
 
+void SUPDialog::Open(const FUPAssetQuery& InQuery)
+{
+	FSlateApplication::Get().AddWindow(
+		SNew(SUPDialog, InQuery)
+	);
+}
+
+void SUPDialog::RunAssetQuery()
+{
+	PendingQueryRows.Reset();
+	NextQueryRow = 0;
+	PendingQuery->Evaluate(PendingQueryRows);
+	PendingQuery.Reset();
+	QueryTickerHandle = FTSTicker::GetCoreTicker().AddTicker(
+		FTickerDelegate::CreateSP(this, &SUPDialog::TickQueryRows));
+}
+
+bool SUPDialog::TickQueryRows(float DeltaTime)
+{
+	// hand the matches to the list a slice per frame, the window stays responsive on huge queries
+	constexpr int32 RowsPerTick = 2000;
+	const int32 End = FMath::Min(NextQueryRow + RowsPerTick, PendingQueryRows.Num());
+	RenameData.Reserve(PendingQueryRows.Num());
+	const int32 FirstRow = RenameData.Num();
+	for (; NextQueryRow < End; NextQueryRow++)
+	{
+		RenameData.Add(MakeShareable(new FRenameActionData(PendingQueryRows[NextQueryRow], &IsFolder, &ShouldEditPath)));
+	}
+	AddRowsToIndex(FirstRow);
+	SetTitle(MakeDialogTitle());
+	if (NextQueryRow < PendingQueryRows.Num())
+	{
+		AssetRegistryProgress = FText::FromString(FString::Printf(TEXT("Collecting assets %d / %d"),
+			NextQueryRow, PendingQueryRows.Num()));
+		return true;
+	}
+	PendingQueryRows.Empty();
+	bStreamingRows = false;
+	QueryTickerHandle.Reset();
+	return false;
+}
+
 void SUPDialog::Open(const TArray<AActor*> InSelectedActors)
 {
 	FSlateApplication::Get().AddWindow(
@@ -725,6 +1407,13 @@ void SUPDialog::Open(const TArray<AActor*> InSelectedActors)
 	);
 }
 
+void SUPDialog::Open(UWorld* InWorld)
+{
+	FSlateApplication::Get().AddWindow(
+		SNew(SUPDialog, InWorld)
+	);
+}
+
 void SUPDialog::ResetOperations()
 {
 	NumCharactersToRemoveAtBegin = 0;
@@ -735,7 +1424,6 @@ void SUPDialog::ResetOperations()
 	ReplaceText = FText::GetEmpty();
 	bIgnoreCase = false;
 	bUseRegex = false;
-	EndEdit.Broadcast();
 	bStartOperationEdit = false;
 }
 
@@ -747,29 +1435,20 @@ void SUPDialog::ResetAll()
 	}
 	ResetOperations();
 	bStartOperationEdit = false;
+	UpdateRowIndices();
 }
 
 void SUPDialog::ApplyOperations()
 {
 	for (auto& Data : RenameData)
 	{
-		if (NumCharactersToRemoveAtBegin)
-		{
-			int N_Remove = FMath::Clamp(NumCharactersToRemoveAtBegin, 0, Data->TempFinalPath.Len() - 1);
-			Data->TempFinalPath.RemoveAt(0, N_Remove);
-		}
-		if (NumCharactersToRemoveAtEnd)
-		{
-			int N_Remove = FMath::Clamp(NumCharactersToRemoveAtEnd, 0, Data->TempFinalPath.Len() - 1);
-			Data->TempFinalPath.RemoveAt(Data->TempFinalPath.Len() - N_Remove ,
-				N_Remove);
-		}
-		if (NumCharactersToRemoveAtBegin && NumCharactersToRemoveAtEnd &&
-			NumCharactersToRemoveAtBegin + NumCharactersToRemoveAtEnd >= Data->TempFinalPath.Len())
+		int32 Head, Tail;
+		if (!TrimName(Data->TempFinalPath.Len(), NumCharactersToRemoveAtBegin, NumCharactersToRemoveAtEnd, Head, Tail))
 		{
 			Data->TempFinalPath = "";
 			continue;
 		}
+		Data->TempFinalPath = Data->TempFinalPath.Mid(Head, Data->TempFinalPath.Len() - Head - Tail);
 		if (!Prefix.IsEmpty())
 		{
 			Data->TempFinalPath = Prefix.ToString() + Data->TempFinalPath;
@@ -799,7 +1478,15 @@ void SUPDialog::ApplyOperations()
 		if (!IsActor)
 			Data->CheckNewPathDuplicated();
 	}
+	if (IsActor)
+	{
+		for (auto& Data : RenameData)
+		{
+			Data->SyncLabelIndex();
+		}
+	}
 	ResetOperations();
+	UpdateRowIndices();
 }
 
 
@@ -827,208 +1514,63 @@ void SUPDialog::ExecuteRename()
 
 void SUPDialog::ActorsRename()
 {
-	for (auto Data : RenameData)
-	{
-		Data->TargetActor->SetActorLabel(Data->TempFinalPath);
-	}
-	RequestDestroyWindow();
-}
-
-void SUPDialog::FoldersRename()
-{
-	if (!bApplyPerforceFix)
+	if (UWorld* World = PartitionedWorld.Get())
 	{
-		// rename folder
+		TArray<TPair<FGuid, FString>> Labels;
 		for (auto Data : RenameData)
 		{
-			UEditorAssetLibrary::RenameDirectory(Data->OriginalFullPath, Data->GetFinalPath());
+			if (Data->GetNewNameStatus() != ENewNameValidStatus::NoChange)
+				Labels.Emplace(Data->ActorGuid, Data->TempFinalPath);
 		}
+		FUPActorRelabeler::RelabelPartitioned(World, Labels);
 		RequestDestroyWindow();
 		return;
 	}
-	
-	// start p4 connection
-	ClientApi P4Api;
-	FP4RecordSet Records;
-	FP4ResultInfo ResultInfo;
-	FUPPerforceConnection Connection = FUPPerforceConnection(P4Api, Records, ResultInfo);
-	if (!Connection.Init())
-	{
-		UUPBulkRenameUtility::NotifyError(FText::FromString("Login perforce failed"));
-		RequestDestroyWindow();
-		return;
-	}
-
-	// prepare for edit
-	TArray<FString> OriginalAssets; // standard obj path
-	UUPBulkRenameUtility::StopSourceControl();
+	TArray<TPair<AActor*, FString>> Labels;
 	for (auto Data : RenameData)
 	{
-		OriginalAssets.Append(UEditorAssetLibrary::ListAssets(Data->OriginalFullPath));
-	}
-
-	// collect references and dependencies and then use external script to batch checkout files
-	FAssetRegistryModule& AssetRegistryModule = FModuleManager::LoadModuleChecked<FAssetRegistryModule>(TEXT("AssetRegistry"));
-	IAssetRegistry& AssetRegistry = AssetRegistryModule.Get();
-	TArray<FName> Referencers;
-	TArray<FAssetIdentifier> AssetDependencies;
-	TArray<FString> FilesToEdit;
-	for (auto Asset : OriginalAssets)
-	{
-		FString Left;
-		Asset.Split(TEXT("."), &Left, nullptr);
-		FName PkgName = FName(Left);
-		FilesToEdit.Add(UUPBulkRenameUtility::MakeSysPath(Asset));
-		Referencers.Reset();
-		AssetRegistry.GetReferencers(PkgName, Referencers);
-		AssetDependencies.Reset();
-		AssetRegistry.GetDependencies(FAssetIdentifier(PkgName), AssetDependencies);
-		for (auto Referencer : Referencers)
-		{
-			FilesToEdit.Add(UUPBulkRenameUtility::MakeSysPath(Referencer.ToString(), false, true));
-		}
-		for (auto AssetDependency : AssetDependencies)
-		{
-			FilesToEdit.Add(UUPBulkRenameUtility::MakeSysPath(AssetDependency.ToString(), false, true));
-		}
+		Labels.Emplace(Data->TargetActor, Data->TempFinalPath);
 	}
+	FUPActorRelabeler::Relabel(Labels);
+	RequestDestroyWindow();
+}
 
-	if (!Connection.RunCommand("edit", FilesToEdit))
-	{
-		UE_LOG(LogUPBulkRename, Error, TEXT("Checkout file failed..."))
-		UUPBulkRenameUtility::NotifyError(FText::FromString("Can not checkout files..."));
-		RequestDestroyWindow();
-		return;
-	}
-
-	// rename folder
- 	for (auto Data : RenameData)
- 	{
- 		UEditorAssetLibrary::RenameDirectory(Data->OriginalFullPath, Data->GetFinalPath());
- 	}
-
-	// run hack actions
-	TArray<FString> RenamedAssets;
+void SUPDialog::FoldersRename()
+{
+	// every asset under the folders and where it ends up, before anything moves
+	TArray<TPair<FString, FString>> FolderPaths;
 	for (auto Data : RenameData)
 	{
-		RenamedAssets.Append(UEditorAssetLibrary::ListAssets(Data->GetFinalPath()));
+		FolderPaths.Emplace(Data->OriginalFullPath, Data->GetFinalPath());
 	}
-
-	for (int i = 0; i < RenamedAssets.Num(); i++)
+	FUPRenameExecutor Executor(FUPRenamePlan::MakeForFolders(FolderPaths), bApplyPerforceFix);
+	if (!Executor.Run())
 	{
-		UUPBulkRenameUtility::SystemRename(UUPBulkRenameUtility::MakeSysPath(RenamedAssets[i]),
-			UUPBulkRenameUtility::MakeSysPath(OriginalAssets[i]));
-	}
-	
-	for (int i = 0; i < RenamedAssets.Num(); i++)
-	{
-		TArray<FString> MoveParams;
-		MoveParams.Add(UUPBulkRenameUtility::MakeSysPath(OriginalAssets[i]));
-		MoveParams.Add(UUPBulkRenameUtility::MakeSysPath(RenamedAssets[i]));
-		if (!Connection.RunCommand(TEXT("move"), MoveParams))
-		{
-			FString Msg = FString::Printf(TEXT("Can not move file from %s to %s"), *MoveParams[0], *MoveParams[1]);
-			UE_LOG(LogUPBulkRename, Error, TEXT("%s"), *Msg);
-			UUPBulkRenameUtility::NotifyError(FText::FromString(Msg));
-		}
+		return;
 	}
-	UUPBulkRenameUtility::StartSourceControl_Perforce();
-	// done?
 	RequestDestroyWindow();
 	UUPBulkRenameUtility::NotifySuccess(FText::FromString("UpBulk Rename on folder success!"));
 }
 
 void SUPDialog::AssetsRename()
 {
-	if (!bApplyPerforceFix)
-	{
-		for (auto Data : RenameData)
-		{
-			UEditorAssetLibrary::RenameAsset(Data->OriginalFullPath, Data->GetFinalPath());
-		}
-		RequestDestroyWindow();
-		return;
-	}
-
-	ClientApi P4Api;
-	FP4RecordSet Records;
-	FP4ResultInfo ResultInfo;
-	FUPPerforceConnection Connection = FUPPerforceConnection(P4Api, Records, ResultInfo);
-	if (!Connection.Init())
-	{
-		UUPBulkRenameUtility::NotifyError(FText::FromString("Login perforce failed"));
-		RequestDestroyWindow();
-		return;
-	}
-	UUPBulkRenameUtility::StopSourceControl();
-		
-	// collect references and dependencies and then use external script to batch checkout files
-	FAssetRegistryModule& AssetRegistryModule = FModuleManager::LoadModuleChecked<FAssetRegistryModule>(TEXT("AssetRegistry"));
-	IAssetRegistry& AssetRegistry = AssetRegistryModule.Get();
-	TArray<FName> Referencers;
-	TArray<FAssetIdentifier> AssetDependencies;
-	TArray<FString> FilesToEdit;
+	TArray<TPair<FString, FString>> AssetPaths;
 	for (auto Data : RenameData)
 	{
-		FString Left;
-		Data->OriginalFullPath.Split(TEXT("."), &Left, nullptr);
-		FName PkgName = FName(Left);
-		FilesToEdit.Add(UUPBulkRenameUtility::MakeSysPath(Data->OriginalFullPath));
-		Referencers.Reset();
-		AssetRegistry.GetReferencers(PkgName, Referencers);
-		AssetDependencies.Reset();
-		AssetRegistry.GetDependencies(FAssetIdentifier(PkgName), AssetDependencies);
-		for (auto Referencer : Referencers)
-		{
-			FilesToEdit.Add(UUPBulkRenameUtility::MakeSysPath(Referencer.ToString(), false, true));
-		}
-		for (auto AssetDependency : AssetDependencies)
-		{
-			FilesToEdit.Add(UUPBulkRenameUtility::MakeSysPath(AssetDependency.ToString(), false, true));
-		}
+		AssetPaths.Emplace(Data->OriginalFullPath, Data->GetFinalPath());
 	}
-	if (!Connection.RunCommand(TEXT("edit"), FilesToEdit))
+	FUPRenameExecutor Executor(FUPRenamePlan::MakeForAssets(AssetPaths), bApplyPerforceFix);
+	if (!Executor.Run())
 	{
-		UE_LOG(LogUPBulkRename, Error, TEXT("Checkout file failed..."))
-		UUPBulkRenameUtility::NotifyError(FText::FromString("Can not checkout files..."));
-		RequestDestroyWindow();
 		return;
 	}
-
-	
- 	for (auto Data : RenameData)
- 	{
- 		UEditorAssetLibrary::RenameAsset(Data->OriginalFullPath, Data->GetFinalPath());
- 	}
-	
-	for (auto Data : RenameData)
-	{
-		UUPBulkRenameUtility::SystemRename(UUPBulkRenameUtility::MakeSysPath(Data->GetFinalPath()),
-			UUPBulkRenameUtility::MakeSysPath(Data->OriginalFullPath));
-	}
-	for (auto Data : RenameData)
-	{
-		TArray<FString> RenameParams = {
-			UUPBulkRenameUtility::MakeSysPath(Data->OriginalFullPath),
-			UUPBulkRenameUtility::MakeSysPath(Data->GetFinalPath())
-		};
-		
-		if (!Connection.RunCommand(TEXT("move"), RenameParams))
-		{
-			FString Msg = FString::Printf(TEXT("Can not move file from %s to %s"), *RenameParams[0], *RenameParams[1]);
-			UE_LOG(LogUPBulkRename, Error, TEXT("%s"), *Msg);
-			UUPBulkRenameUtility::NotifyError(FText::FromString(Msg));
-		}
-	}
-
-	UUPBulkRenameUtility::StartSourceControl_Perforce();
 	UUPBulkRenameUtility::NotifySuccess(FText::FromString("UpBulk Rename on assets success!"));
 	RequestDestroyWindow();
 }
 
 bool SUPDialog::CanExecuteRename() const
 {
-	if (bStartOperationEdit) return false;
+	if (bStartOperationEdit || bWaitingForAssetRegistry || bStreamingRows) return false;
 	for (auto Data : RenameData)
 	{
 		if (Data->GetNewNameStatus() == ENewNameValidStatus::InValid ||
@@ -1045,83 +1587,89 @@ bool SUPDialog::CanExecuteRename() const
 
 void SUPDialog::UpdateOperationEditPreview()
 {
-	if (!bStartOperationEdit)
+	bStartOperationEdit = true;
+	const FString PrefixString = Prefix.ToString();
+	const FString SuffixString = Suffix.ToString();
+	const FString Search = SearchText.ToString();
+	const FString Replace = ReplaceText.ToString();
+	const ESearchCase::Type SearchCase = bIgnoreCase? ESearchCase::IgnoreCase : ESearchCase::CaseSensitive;
+	TOptional<FRegexPattern> SearchRegex;
+	if (bUseRegex && !Search.IsEmpty())
 	{
-		StartEdit.Broadcast();
-		bStartOperationEdit = true;
+		SearchRegex.Emplace(Search);
 	}
+
+	// mirrors ApplyOperations: trim, then prefix and suffix, then search and replace over the result
+	TArray<TPair<int32, int32>> Matches;
 	for (auto Data : RenameData)
 	{
-		Data->RenamingPath = Data->TempFinalPath;
-		if (NumCharactersToRemoveAtBegin)
+		FUPPreview& Preview = Data->Preview;
+		Preview.Reset();
+		const FString& Name = Data->TempFinalPath;
+		int32 Head, Tail;
+		if (!TrimName(Name.Len(), NumCharactersToRemoveAtBegin, NumCharactersToRemoveAtEnd, Head, Tail))
 		{
-			FString Temp = Data->RenamingPath;
-			Data->RenamingPath = "<r>" + Temp.Mid(0, NumCharactersToRemoveAtBegin) + "</>" +
-				Temp.Mid( NumCharactersToRemoveAtBegin);
-		}
-		if (NumCharactersToRemoveAtEnd)
-		{
-			FString Temp = Data->RenamingPath;
-			Data->RenamingPath = Temp.Mid(0, Temp.Len() - NumCharactersToRemoveAtEnd) + "<r>" + 
-				Temp.Mid( Temp.Len() - NumCharactersToRemoveAtEnd) + "</>";
-		}
-		if (NumCharactersToRemoveAtBegin && NumCharactersToRemoveAtEnd &&
-			NumCharactersToRemoveAtBegin + NumCharactersToRemoveAtEnd >= Data->TempFinalPath.Len())
-		{
-			Data->RenamingPath = "<r>" + Data->TempFinalPath + "</>";
+			Preview.Append(Name, EPreviewSpan::Removed);
 			continue;
 		}
-		if (!Prefix.IsEmpty())
-		{
-			Data->RenamingPath = "<a>" + Prefix.ToString() + "</>" + Data->RenamingPath;
-		}
-		if (!Suffix.IsEmpty())
-		{
-			Data->RenamingPath += "<a>" + Suffix.ToString() + "</>";
-		}
-		if (!SearchText.IsEmpty())
+		const FStringView NameView(Name);
+		const TPair<FStringView, EPreviewSpan::Type> Parts[] = {
+			{PrefixString, EPreviewSpan::Added},
+			{NameView.Left(Head), EPreviewSpan::Removed},
+			{NameView.Mid(Head, Name.Len() - Head - Tail), EPreviewSpan::Kept},
+			{NameView.Right(Tail), EPreviewSpan::Removed},
+			{SuffixString, EPreviewSpan::Added}
+		};
+
+		// matches are searched in what survives the trim
+		Matches.Reset();
+		if (!Search.IsEmpty())
 		{
-			FString Temp = Data->RenamingPath;
-			FString Left, Right;
-			int TempN = 0;
-			if (!bUseRegex)
+			const FString Live = PrefixString + FString(NameView.Mid(Head, Name.Len() - Head - Tail)) + SuffixString;
+			if (SearchRegex.IsSet())
 			{
-				ESearchCase::Type SearchCase = bIgnoreCase? ESearchCase::IgnoreCase : ESearchCase::CaseSensitive;
-				while (Temp.Split(SearchText.ToString(), &Left, &Right, SearchCase))
+				FRegexMatcher Matcher(SearchRegex.GetValue(), Live);
+				while (Matcher.FindNext())
 				{
-					if (TempN == 0)
-						Data->RenamingPath = "";
-					Data->RenamingPath += Left + "<r>" + SearchText.ToString() + "</>" + "<a>" + ReplaceText.ToString() + "</>";
-					Temp = Right;
-					TempN++;
+					if (Matcher.GetMatchEnding() > Matcher.GetMatchBeginning())
+						Matches.Emplace(Matcher.GetMatchBeginning(), Matcher.GetMatchEnding());
 				}
 			}
 			else
 			{
-				FRegexMatcher Matcher(FRegexPattern(SearchText.ToString()), Data->TempFinalPath);
-				while (Matcher.FindNext())
+				for (int32 Found = Live.Find(Search, SearchCase); Found != INDEX_NONE;
+					Found = Live.Find(Search, SearchCase, ESearchDir::FromStart, Found + Search.Len()))
 				{
-					if (TempN==0)
-					{
-						Data->RenamingPath = "";
-					}
-					TempN++;
-					const int MatchStart = Matcher.GetMatchBeginning();
-					const int MatchEnd   = Matcher.GetMatchEnding();
-					FString Matched = Data->TempFinalPath.Mid(MatchStart, MatchEnd - MatchStart);
-					Temp.Split(Matched, &Left, &Right, ESearchCase::CaseSensitive);
-					Data->RenamingPath += Left + "<r>" + Matched + "</>" + "<a>" + ReplaceText.ToString() + "</>";
-					Temp = Right;
+					Matches.Emplace(Found, Found + Search.Len());
+				}
+			}
+		}
+
+		int32 LiveIndex = 0;
+		int32 MatchIndex = 0;
+		for (const TPair<FStringView, EPreviewSpan::Type>& Part : Parts)
+		{
+			if (Part.Value == EPreviewSpan::Removed || Matches.IsEmpty())
+			{
+				Preview.Append(Part.Key, Part.Value);
+				LiveIndex += Part.Value == EPreviewSpan::Removed ? 0 : Part.Key.Len();
+				continue;
+			}
+			for (const TCHAR Char : Part.Key)
+			{
+				const bool bInMatch = MatchIndex < Matches.Num() && LiveIndex >= Matches[MatchIndex].Key;
+				Preview.Append(Char, bInMatch ? EPreviewSpan::Removed : Part.Value);
+				LiveIndex++;
+				if (bInMatch && LiveIndex == Matches[MatchIndex].Value)
+				{
+					Preview.Append(Replace, EPreviewSpan::Added);
+					MatchIndex++;
 				}
 			}
-			Data->RenamingPath += Right;
 		}
 	}
 }
 
-
-
-
 END_SLATE_FUNCTION_BUILD_OPTIMIZATION
 
 #undef LOCTEXT_NAMESPACE
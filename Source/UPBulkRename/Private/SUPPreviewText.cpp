@@ -0,0 +1,87 @@
+// Copyright 2024 PufStudio. All Rights Reserved.
+
+#include "SUPPreviewText.h"
+
+#include "UPBulkRenameStyle.h"
+#include "Fonts/FontMeasure.h"
+#include "Framework/Application/SlateApplication.h"
+
+void FUPPreview::Reset()
+{
+	Text.Reset();
+	Spans.Reset();
+}
+
+void FUPPreview::Append(FStringView Chars, EPreviewSpan::Type Kind)
+{
+	if (Chars.IsEmpty())
+	{
+		return;
+	}
+	if (Spans.Num() && Spans.Last().Kind == Kind)
+	{
+		Spans.Last().Len += Chars.Len();
+	}
+	else
+	{
+		Spans.Add({Text.Len(), Chars.Len(), Kind});
+	}
+	Text.Append(Chars);
+}
+
+void SUPPreviewText::Construct(const FArguments& InArgs)
+{
+	Preview = InArgs._Preview;
+	SetClipping(EWidgetClipping::ClipToBounds);
+}
+
+int32 SUPPreviewText::OnPaint(const FPaintArgs& Args, const FGeometry& AllottedGeometry, const FSlateRect& MyCullingRect,
+	FSlateWindowElementList& OutDrawElements, int32 LayerId, const FWidgetStyle& InWidgetStyle, bool bParentEnabled) const
+{
+	if (!Preview || Preview->Text.IsEmpty())
+	{
+		return LayerId;
+	}
+	const ISlateStyle& Style = FUPBulkRenameStyle::Get();
+	const FTextBlockStyle* KindStyles[] = {
+		&Style.GetWidgetStyle<FTextBlockStyle>("Default"),
+		&Style.GetWidgetStyle<FTextBlockStyle>("r"),
+		&Style.GetWidgetStyle<FTextBlockStyle>("a")
+	};
+	const TSharedRef<FSlateFontMeasure> FontMeasure = FSlateApplication::Get().GetRenderer()->GetFontMeasureService();
+	const ESlateDrawEffect DrawEffect = ShouldBeEnabled(bParentEnabled) ? ESlateDrawEffect::None : ESlateDrawEffect::DisabledEffect;
+	const FSlateFontInfo& Font = KindStyles[0]->Font;
+	const float LineHeight = FontMeasure->GetMaxCharacterHeight(Font);
+	const float Top = FMath::Max(0.f, (AllottedGeometry.GetLocalSize().Y - LineHeight) * 0.5f);
+
+	float X = 0.f;
+	for (const FUPPreviewSpan& Span : Preview->Spans)
+	{
+		const FTextBlockStyle& SpanStyle = *KindStyles[Span.Kind];
+		const int32 End = Span.Start + Span.Len;
+		const FVector2f Size(FontMeasure->Measure(Preview->Text, Span.Start, End, Font).X, LineHeight);
+		const FLinearColor Color = SpanStyle.ColorAndOpacity.GetColor(InWidgetStyle) * InWidgetStyle.GetColorAndOpacityTint();
+		FSlateDrawElement::MakeText(OutDrawElements, LayerId,
+			AllottedGeometry.ToPaintGeometry(Size, FSlateLayoutTransform(FVector2f(X, Top))),
+			Preview->Text, Span.Start, End, Font, DrawEffect, Color);
+		if (Span.Kind == EPreviewSpan::Removed)
+		{
+			FSlateDrawElement::MakeBox(OutDrawElements, LayerId + 1,
+				AllottedGeometry.ToPaintGeometry(FVector2f(Size.X, 1.f), FSlateLayoutTransform(FVector2f(X, Top + LineHeight * 0.5f))),
+				&SpanStyle.StrikeBrush, DrawEffect, Color);
+		}
+		X += Size.X;
+	}
+	return LayerId + 1;
+}
+
+FVector2D SUPPreviewText::ComputeDesiredSize(float LayoutScaleMultiplier) const
+{
+	const TSharedRef<FSlateFontMeasure> FontMeasure = FSlateApplication::Get().GetRenderer()->GetFontMeasureService();
+	const FSlateFontInfo& Font = FUPBulkRenameStyle::Get().GetWidgetStyle<FTextBlockStyle>("Default").Font;
+	if (!Preview || Preview->Text.IsEmpty())
+	{
+		return FVector2D(0.f, FontMeasure->GetMaxCharacterHeight(Font));
+	}
+	return FVector2D(FontMeasure->Measure(Preview->Text, Font).X, FontMeasure->GetMaxCharacterHeight(Font));
+}
@@ -0,0 +1,284 @@
+// Copyright 2024 PufStudio. All Rights Reserved.
+
+#include "SUPQueryDialog.h"
+
+#include "SlateOptMacros.h"
+#include "SUPDialog.h"
+#include "UPActorQuery.h"
+#include "UPAssetQuery.h"
+#include "UPBulkRenameUtility.h"
+
+#define LOCTEXT_NAMESPACE "UPQueryDialog"
+
+BEGIN_SLATE_FUNCTION_BUILD_OPTIMIZATION
+
+void SUPQueryDialog::Construct(const FArguments& InArgs, const TArray<FString>& InRootPaths)
+{
+	RootPaths = FText::FromString(FString::Join(InRootPaths, TEXT(", ")));
+	CreateDialogContent();
+}
+
+void SUPQueryDialog::Construct(const FArguments& InArgs, UWorld* InWorld)
+{
+	World = InWorld;
+	CreateDialogContent();
+}
+
+void SUPQueryDialog::CreateDialogContent()
+{
+	const bool bActors = World.IsValid();
+	TSharedRef<SVerticalBox> Fields = SNew(SVerticalBox);
+	if (bActors)
+	{
+		Fields->AddSlot().AutoHeight().Padding(0.f, 2.f)
+		[
+			MakeField("Classes", "StaticMeshActor, /Script/Engine.PointLight", ClassNames)
+		];
+		Fields->AddSlot().AutoHeight().Padding(0.f, 2.f)
+		[
+			MakeNameField("Label", "SM_*")
+		];
+		Fields->AddSlot().AutoHeight().Padding(0.f, 2.f)
+		[
+			MakeField("Folders", "Props, Lighting/Interior", RootPaths)
+		];
+		Fields->AddSlot().AutoHeight().Padding(0.f, 2.f)
+		[
+			MakeField("Data layers", "DL_Gameplay, DL_Foliage", DataLayers)
+		];
+		Fields->AddSlot().AutoHeight().Padding(0.f, 2.f)
+		[
+			MakeField("Tags", "Tag; OtherTag", Tags)
+		];
+	}
+	else
+	{
+		Fields->AddSlot().AutoHeight().Padding(0.f, 2.f)
+		[
+			MakeField("Paths", "/Game/Props, /MyPlugin/Meshes", RootPaths)
+		];
+		Fields->AddSlot().AutoHeight().Padding(0.f, 2.f)
+		[
+			MakeField("Classes", "StaticMesh, /Script/Engine.Texture2D", ClassNames)
+		];
+		Fields->AddSlot().AutoHeight().Padding(0.f, 2.f)
+		[
+			MakeNameField("Name", "SM_*")
+		];
+		Fields->AddSlot().AutoHeight().Padding(0.f, 2.f)
+		[
+			MakeField("Tags", "Key=Value; OtherKey", Tags)
+		];
+	}
+	Fields->AddSlot()
+	.AutoHeight()
+	.HAlign(HAlign_Right)
+	.Padding(0.f, 10.f, 0.f, 0.f)
+	[
+		SNew(SButton)
+		.Text(FText::FromString(bActors ? "Find actors" : "Find assets"))
+		.ToolTipText(FText::FromString(bActors ? "Filter the level's actors and open bulk rename on the matches"
+			: "Query the asset registry and open bulk rename on the matches"))
+		.OnPressed(this, &SUPQueryDialog::RunQuery)
+	];
+
+	SWindow::Construct(SWindow::FArguments()
+	.Title(FText::FromString(bActors ? "UP Bulk Rename actors by query" : "UP Bulk Rename by query"))
+	.SizingRule(ESizingRule::Autosized)
+	.SupportsMaximize(false)
+	.SupportsMinimize(false)
+	.HasCloseButton(true)
+	[
+		SNew( SBorder )
+		.Padding( 4.f )
+		.BorderImage( FAppStyle::GetBrush( "ToolPanel.GroupBorder" ) )
+		[
+			SNew(SBox)
+			.Padding(8)
+			.MinDesiredWidth(520)
+			[
+				Fields
+			]
+		]
+	]);
+}
+
+TSharedRef<SWidget> SUPQueryDialog::MakeNameField(const FString& Label, const FString& Hint)
+{
+	return SNew(SHorizontalBox)
+	+SHorizontalBox::Slot()
+	.FillWidth(1.f)
+	[
+		MakeField(Label, Hint, NamePattern)
+	]
+	+SHorizontalBox::Slot()
+	.AutoWidth()
+	.VAlign(VAlign_Center)
+	.Padding(10.f, 0.f, 2.f, 0.f)
+	[
+		SNew(STextBlock)
+		.Text(FText::FromString(".*"))
+	]
+	+SHorizontalBox::Slot()
+	.AutoWidth()
+	[
+		SNew(SCheckBox)
+		.ToolTipText(FText::FromString("Regex?"))
+		.IsChecked_Lambda([this](){ return bNameIsRegex ? ECheckBoxState::Checked : ECheckBoxState::Unchecked; })
+		.OnCheckStateChanged_Lambda([this](const ECheckBoxState NewState)
+		{
+			bNameIsRegex = NewState == ECheckBoxState::Checked;
+		})
+	];
+}
+
+TSharedRef<SWidget> SUPQueryDialog::MakeField(const FString& Label, const FString& Hint, FText& Value)
+{
+	return SNew(SHorizontalBox)
+	+SHorizontalBox::Slot()
+	.FillWidth(0.3f)
+	.VAlign(VAlign_Center)
+	[
+		SNew(STextBlock)
+		.Text(FText::FromString(Label))
+	]
+	+SHorizontalBox::Slot()
+	.FillWidth(1.f)
+	[
+		SNew(SEditableTextBox)
+		.HintText(FText::FromString(Hint))
+		.Text_Lambda([&Value](){ return Value; })
+		.OnTextChanged_Lambda([&Value](const FText& NewText)
+		{
+			Value = NewText;
+		})
+	];
+}
+
+void SUPQueryDialog::Open(const TArray<FString>& InRootPaths)
+{
+	FSlateApplication::Get().AddWindow(
+		SNew(SUPQueryDialog, InRootPaths)
+	);
+}
+
+void SUPQueryDialog::Open(UWorld* InWorld)
+{
+	FSlateApplication::Get().AddWindow(
+		SNew(SUPQueryDialog, InWorld)
+	);
+}
+
+void SUPQueryDialog::RunQuery()
+{
+	if (World.IsValid())
+	{
+		RunActorQuery(World.Get());
+		return;
+	}
+	FUPAssetQuery Query;
+	TArray<FString> Items;
+	RootPaths.ToString().ParseIntoArray(Items, TEXT(","));
+	for (const FString& Item : Items)
+	{
+		FString Path = Item.TrimStartAndEnd();
+		Path.RemoveFromEnd(TEXT("/"));
+		if (!Path.IsEmpty())
+			Query.PackagePaths.Add(FName(Path));
+	}
+
+	Items.Reset();
+	ClassNames.ToString().ParseIntoArray(Items, TEXT(","));
+	for (const FString& Item : Items)
+	{
+		FTopLevelAssetPath ClassPath = FUPAssetQuery::ParseClassPath(Item);
+		if (ClassPath.IsNull())
+		{
+			UUPBulkRenameUtility::NotifyError(FText::FromString("Unknown class: " + Item.TrimStartAndEnd()));
+			return;
+		}
+		Query.ClassPaths.Add(ClassPath);
+	}
+
+	Query.NamePattern = NamePattern.ToString().TrimStartAndEnd();
+	Query.bNameIsRegex = bNameIsRegex;
+
+	Items.Reset();
+	Tags.ToString().ParseIntoArray(Items, TEXT(";"));
+	for (const FString& Item : Items)
+	{
+		FString Key, Value;
+		if (Item.Split(TEXT("="), &Key, &Value))
+		{
+			Query.TagsAndValues.Add(FName(Key.TrimStartAndEnd()), Value.TrimStartAndEnd());
+		}
+		else if (!Item.TrimStartAndEnd().IsEmpty())
+		{
+			Query.TagsAndValues.Add(FName(Item.TrimStartAndEnd()), TOptional<FString>());
+		}
+	}
+
+	SUPDialog::Open(Query);
+	RequestDestroyWindow();
+}
+
+void SUPQueryDialog::RunActorQuery(UWorld* InWorld)
+{
+	FUPActorQuery Query;
+	TArray<FString> Items;
+	ClassNames.ToString().ParseIntoArray(Items, TEXT(","));
+	for (const FString& Item : Items)
+	{
+		const UClass* Class = FUPActorQuery::ParseClass(Item);
+		if (!Class)
+		{
+			UUPBulkRenameUtility::NotifyError(FText::FromString("Unknown actor class: " + Item.TrimStartAndEnd()));
+			return;
+		}
+		Query.Classes.Add(Class);
+	}
+
+	Query.LabelPattern = NamePattern.ToString().TrimStartAndEnd();
+	Query.bLabelIsRegex = bNameIsRegex;
+
+	Items.Reset();
+	RootPaths.ToString().ParseIntoArray(Items, TEXT(","));
+	for (const FString& Item : Items)
+	{
+		FString Folder = Item.TrimStartAndEnd();
+		Folder.RemoveFromStart(TEXT("/"));
+		Folder.RemoveFromEnd(TEXT("/"));
+		if (!Folder.IsEmpty())
+			Query.Folders.Add(Folder);
+	}
+
+	Items.Reset();
+	DataLayers.ToString().ParseIntoArray(Items, TEXT(","));
+	for (const FString& Item : Items)
+	{
+		if (!Item.TrimStartAndEnd().IsEmpty())
+			Query.DataLayers.Add(FName(Item.TrimStartAndEnd()));
+	}
+
+	Items.Reset();
+	Tags.ToString().ParseIntoArray(Items, TEXT(";"));
+	for (const FString& Item : Items)
+	{
+		if (!Item.TrimStartAndEnd().IsEmpty())
+			Query.Tags.Add(FName(Item.TrimStartAndEnd()));
+	}
+
+	TArray<AActor*> Actors;
+	Query.Evaluate(InWorld, Actors);
+	if (Actors.IsEmpty())
+	{
+		UUPBulkRenameUtility::NotifyError(FText::FromString("No actor matches the query"));
+		return;
+	}
+	SUPDialog::Open(Actors);
+	RequestDestroyWindow();
+}
+
+END_SLATE_FUNCTION_BUILD_OPTIMIZATION
+
+#undef LOCTEXT_NAMESPACE
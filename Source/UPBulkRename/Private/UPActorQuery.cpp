@@ -0,0 +1,114 @@
+// Copyright 2024 PufStudio. All Rights Reserved.
+
+#include "UPActorQuery.h"
+
+#include "EngineUtils.h"
+#include "UPPerforceConnection.h"
+#include "Async/ParallelFor.h"
+#include "Internationalization/Regex.h"
+#include "WorldPartition/DataLayer/DataLayerAsset.h"
+
+void FUPActorQuery::Evaluate(UWorld* World, TArray<AActor*>& OutActors) const
+{
+	if (!World)
+	{
+		return;
+	}
+	const double StartTime = FPlatformTime::Seconds();
+
+	// touching the world is game thread only, everything after is read-only
+	TArray<AActor*> Actors;
+	for (FActorIterator It(World); It; ++It)
+	{
+		AActor* Actor = *It;
+		if (Actor->IsEditable() && Actor->IsListedInSceneOutliner())
+		{
+			Actors.Add(Actor);
+		}
+	}
+
+	TOptional<FRegexPattern> LabelRegex;
+	if (bLabelIsRegex && !LabelPattern.IsEmpty())
+	{
+		LabelRegex.Emplace(LabelPattern);
+	}
+	const bool bFilterLabel = !LabelPattern.IsEmpty() && LabelPattern != TEXT("*");
+
+	auto Matches = [&](const AActor* Actor)
+	{
+		if (!Classes.IsEmpty() && !Classes.ContainsByPredicate([Actor](const UClass* Class){ return Actor->IsA(Class); }))
+		{
+			return false;
+		}
+		if (!Tags.IsEmpty() && !Tags.ContainsByPredicate([Actor](const FName Tag){ return Actor->Tags.Contains(Tag); }))
+		{
+			return false;
+		}
+		if (!Folders.IsEmpty())
+		{
+			const FString FolderPath = Actor->GetFolderPath().ToString();
+			if (!Folders.ContainsByPredicate([&FolderPath](const FString& Folder)
+			{
+				return FolderPath.StartsWith(Folder) &&
+					(FolderPath.Len() == Folder.Len() || FolderPath[Folder.Len()] == TEXT('/'));
+			}))
+			{
+				return false;
+			}
+		}
+		if (!DataLayers.IsEmpty() && !Actor->GetDataLayerAssets().ContainsByPredicate([this](const UDataLayerAsset* Asset)
+		{
+			return Asset && DataLayers.Contains(Asset->GetFName());
+		}))
+		{
+			return false;
+		}
+		if (bFilterLabel)
+		{
+			// never create a missing label here, it would write to the actor
+			const FString& Label = Actor->GetActorLabel(false);
+			const FString& Name = Label.IsEmpty() ? Actor->GetName() : Label;
+			if (LabelRegex.IsSet())
+			{
+				FRegexMatcher Matcher(LabelRegex.GetValue(), Name);
+				return Matcher.FindNext();
+			}
+			return Name.MatchesWildcard(LabelPattern);
+		}
+		return true;
+	};
+
+	// fixed size slices keep the matches in level order once joined
+	constexpr int32 ActorsPerSlice = 4096;
+	const int32 NumSlices = FMath::DivideAndRoundUp(Actors.Num(), ActorsPerSlice);
+	TArray<TArray<AActor*>> SliceMatches;
+	SliceMatches.SetNum(NumSlices);
+	ParallelFor(NumSlices, [&](int32 Slice)
+	{
+		const int32 End = FMath::Min((Slice + 1) * ActorsPerSlice, Actors.Num());
+		for (int32 i = Slice * ActorsPerSlice; i < End; i++)
+		{
+			if (Matches(Actors[i]))
+			{
+				SliceMatches[Slice].Add(Actors[i]);
+			}
+		}
+	});
+
+	const int32 NumBefore = OutActors.Num();
+	for (TArray<AActor*>& Slice : SliceMatches)
+	{
+		OutActors.Append(MoveTemp(Slice));
+	}
+	UE_LOG(LogUPBulkRename, Display, TEXT("Actor query matched %d of %d actors in %.3fs"),
+		OutActors.Num() - NumBefore, Actors.Num(), FPlatformTime::Seconds() - StartTime);
+}
+
+const UClass* FUPActorQuery::ParseClass(const FString& ClassName)
+{
+	const FString Trimmed = ClassName.TrimStartAndEnd();
+	const UClass* Class = Trimmed.StartsWith(TEXT("/"))
+		? FindObject<UClass>(FTopLevelAssetPath(Trimmed))
+		: FindFirstObject<UClass>(*Trimmed, EFindFirstObjectOptions::NativeFirst);
+	return Class && Class->IsChildOf<AActor>() ? Class : nullptr;
+}
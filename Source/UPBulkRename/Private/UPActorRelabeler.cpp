@@ -0,0 +1,143 @@
+// Copyright 2024 PufStudio. All Rights Reserved.
+
+#include "UPActorRelabeler.h"
+
+#include "Editor.h"
+#include "FileHelpers.h"
+#include "ISourceControlModule.h"
+#include "ScopedTransaction.h"
+#include "UPBulkRenameSettings.h"
+#include "UPBulkRenameUtility.h"
+#include "UPPerforceConnection.h"
+#include "UPRenameExecutor.h"
+#include "Engine/Selection.h"
+#include "Misc/ScopedSlowTask.h"
+#include "WorldPartition/WorldPartition.h"
+#include "WorldPartition/WorldPartitionActorDescInstance.h"
+#include "WorldPartition/WorldPartitionHandle.h"
+
+#define LOCTEXT_NAMESPACE "UPActorRelabeler"
+
+int32 FUPActorRelabeler::Relabel(const TArray<TPair<AActor*, FString>>& Labels)
+{
+	TArray<TPair<AActor*, FString>> Changes;
+	Changes.Reserve(Labels.Num());
+	for (const TPair<AActor*, FString>& Label : Labels)
+	{
+		if (IsValid(Label.Key) && !Label.Key->GetActorLabel().Equals(Label.Value, ESearchCase::CaseSensitive))
+		{
+			Changes.Add(Label);
+		}
+	}
+	if (Changes.IsEmpty())
+	{
+		return 0;
+	}
+
+	const double StartTime = FPlatformTime::Seconds();
+	const FScopedTransaction Transaction(FText::Format(LOCTEXT("RelabelActors", "Bulk Rename {0} Actors"), Changes.Num()));
+
+	// a selected actor rebuilds the details panel on each label change, relabel with nothing selected and restore it once
+	USelection* SelectedActors = GEditor->GetSelectedActors();
+	TArray<AActor*> Selected;
+	SelectedActors->GetSelectedObjects<AActor>(Selected);
+	SelectedActors->BeginBatchSelectOperation();
+	GEditor->SelectNone(false, true, false);
+
+	for (const TPair<AActor*, FString>& Change : Changes)
+	{
+		Change.Key->SetActorLabel(Change.Value);
+	}
+
+	for (AActor* Actor : Selected)
+	{
+		GEditor->SelectActor(Actor, true, false, true);
+	}
+	SelectedActors->EndBatchSelectOperation(false);
+	GEditor->NoteSelectionChange();
+
+	UE_LOG(LogUPBulkRename, Display, TEXT("Relabeled %d actors in %.3fs"), Changes.Num(), FPlatformTime::Seconds() - StartTime);
+	return Changes.Num();
+}
+
+int32 FUPActorRelabeler::RelabelPartitioned(UWorld* World, const TArray<TPair<FGuid, FString>>& Labels)
+{
+	UWorldPartition* WorldPartition = World ? World->GetWorldPartition() : nullptr;
+	if (!WorldPartition)
+	{
+		return 0;
+	}
+
+	TArray<TPair<AActor*, FString>> LoadedLabels;
+	TArray<TPair<FGuid, FString>> UnloadedLabels;
+	for (const TPair<FGuid, FString>& Label : Labels)
+	{
+		const FWorldPartitionActorDescInstance* ActorDesc = WorldPartition->GetActorDescInstance(Label.Key);
+		if (!ActorDesc)
+		{
+			UE_LOG(LogUPBulkRename, Warning, TEXT("No actor %s in %s"), *Label.Key.ToString(), *World->GetName());
+			continue;
+		}
+		if (AActor* Actor = ActorDesc->GetActor())
+		{
+			LoadedLabels.Emplace(Actor, Label.Value);
+		}
+		else if (!ActorDesc->GetActorLabel().ToString().Equals(Label.Value, ESearchCase::CaseSensitive))
+		{
+			UnloadedLabels.Add(Label);
+		}
+	}
+	int32 NumRelabeled = Relabel(LoadedLabels);
+	if (UnloadedLabels.IsEmpty())
+	{
+		return NumRelabeled;
+	}
+
+	const double StartTime = FPlatformTime::Seconds();
+	const int32 BatchSize = FMath::Max(1, GetDefault<UUPBulkRenameSettings>()->UnloadedActorBatchSize);
+	const bool bUseSourceControl = ISourceControlModule::Get().IsEnabled();
+	FScopedSlowTask Progress(float(UnloadedLabels.Num()), FText::Format(LOCTEXT("RelabelUnloaded", "Relabeling {0} unloaded actors"), UnloadedLabels.Num()));
+	Progress.MakeDialog(true);
+	int32 NumFailed = 0;
+	for (int32 Start = 0; Start < UnloadedLabels.Num() && !Progress.ShouldCancel(); Start += BatchSize)
+	{
+		const int32 End = FMath::Min(Start + BatchSize, UnloadedLabels.Num());
+		Progress.EnterProgressFrame(float(End - Start));
+		// the references load the actors without registering them, as the world partition resave builders do
+		FWorldPartitionLoadingContext::FNull LoadingContext;
+		TArray<FWorldPartitionReference> References;
+		TArray<UPackage*> Packages;
+		References.Reserve(End - Start);
+		for (int32 i = Start; i < End; i++)
+		{
+			AActor* Actor = References.Emplace_GetRef(WorldPartition, UnloadedLabels[i].Key).GetActor();
+			if (!Actor || !Actor->GetExternalPackage())
+			{
+				UE_LOG(LogUPBulkRename, Error, TEXT("Can not load actor %s"), *UnloadedLabels[i].Key.ToString());
+				NumFailed++;
+				continue;
+			}
+			Actor->SetActorLabel(UnloadedLabels[i].Value);
+			Packages.Add(Actor->GetExternalPackage());
+		}
+		if (bUseSourceControl)
+		{
+			FEditorFileUtils::CheckoutPackages(Packages, nullptr, false);
+		}
+		const int32 NumFailedToSave = FUPRenameExecutor::SavePackages(Packages);
+		NumFailed += NumFailedToSave;
+		NumRelabeled += Packages.Num() - NumFailedToSave;
+
+		// the descriptors picked up the new labels on save, the actors can go
+		References.Empty();
+		CollectGarbage(GARBAGE_COLLECTION_KEEPFLAGS);
+	}
+	if (NumFailed > 0)
+	{
+		UUPBulkRenameUtility::NotifyError(FText::FromString(FString::Printf(TEXT("%d unloaded actors could not be relabeled, see log"), NumFailed)));
+	}
+	UE_LOG(LogUPBulkRename, Display, TEXT("Relabeled %d unloaded actors in %.3fs"), UnloadedLabels.Num() - NumFailed, FPlatformTime::Seconds() - StartTime);
+	return NumRelabeled;
+}
+
+#undef LOCTEXT_NAMESPACE
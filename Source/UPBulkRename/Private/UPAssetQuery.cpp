@@ -0,0 +1,79 @@
+// Copyright 2024 PufStudio. All Rights Reserved.
+
+#include "UPAssetQuery.h"
+
+#include "AssetRegistry/IAssetRegistry.h"
+#include "Internationalization/Regex.h"
+
+FARFilter FUPAssetQuery::MakeFilter() const
+{
+	FARFilter Filter;
+	Filter.PackagePaths = PackagePaths;
+	Filter.bRecursivePaths = true;
+	Filter.ClassPaths = ClassPaths;
+	Filter.bRecursiveClasses = ClassPaths.Num() > 0;
+	Filter.TagsAndValues = TagsAndValues;
+	Filter.bIncludeOnlyOnDiskAssets = true;
+	return Filter;
+}
+
+void FUPAssetQuery::Evaluate(TArray<FString>& OutObjectPaths) const
+{
+	TOptional<FRegexPattern> NameRegex;
+	if (bNameIsRegex && !NamePattern.IsEmpty())
+	{
+		NameRegex.Emplace(NamePattern);
+	}
+	const bool bFilterName = !NamePattern.IsEmpty() && NamePattern != TEXT("*");
+
+	auto Visit = [&](const FAssetData& AssetData)
+	{
+		if (AssetData.IsRedirector())
+		{
+			return true;
+		}
+		if (bFilterName)
+		{
+			const FString AssetName = AssetData.AssetName.ToString();
+			if (NameRegex.IsSet())
+			{
+				FRegexMatcher Matcher(NameRegex.GetValue(), AssetName);
+				if (!Matcher.FindNext())
+				{
+					return true;
+				}
+			}
+			else if (!AssetName.MatchesWildcard(NamePattern))
+			{
+				return true;
+			}
+		}
+		OutObjectPaths.Add(AssetData.GetObjectPathString());
+		return true;
+	};
+	// an empty filter enumerates nothing, a name only (or no) query walks the whole registry instead
+	const FARFilter Filter = MakeFilter();
+	IAssetRegistry& AssetRegistry = IAssetRegistry::GetChecked();
+	if (Filter.IsEmpty())
+	{
+		AssetRegistry.EnumerateAllAssets(Visit, true);
+	}
+	else
+	{
+		AssetRegistry.EnumerateAssets(Filter, Visit);
+	}
+}
+
+FTopLevelAssetPath FUPAssetQuery::ParseClassPath(const FString& ClassName)
+{
+	FString Trimmed = ClassName.TrimStartAndEnd();
+	if (Trimmed.StartsWith(TEXT("/")))
+	{
+		return FTopLevelAssetPath(Trimmed);
+	}
+	if (const UClass* Class = FindFirstObject<UClass>(*Trimmed, EFindFirstObjectOptions::NativeFirst))
+	{
+		return Class->GetClassPathName();
+	}
+	return FTopLevelAssetPath();
+}
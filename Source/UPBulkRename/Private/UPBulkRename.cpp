@@ -4,8 +4,14 @@
 #include "ContentBrowserModule.h"
 #include "ISettingsModule.h"
 #include "LevelEditor.h"
+#include "Editor.h"
+#include "SUPQueryDialog.h"
+#include "ToolMenus.h"
 #include "UPBulkRenameSettings.h"
 #include "UPBulkRenameStyle.h"
+#include "UPRenameJournal.h"
+#include "AssetRegistry/IAssetRegistry.h"
+#include "Misc/CoreDelegates.h"
 
 
 #define LOCTEXT_NAMESPACE "FUPBulkRenameModule"
@@ -36,6 +42,8 @@ void FUPBulkRenameModule::StartupModule()
 	LevelEditorModule.GetAllLevelViewportContextMenuExtenders();
 	LevelEditorMenuExtenders.Add(FLevelEditorModule::FLevelViewportMenuExtender_SelectedActors::
 		CreateRaw(this, &FUPBulkRenameModule::LevelEditorMenuExtender));
+	UToolMenus::RegisterStartupCallback(FSimpleMulticastDelegate::FDelegate::CreateRaw(this,
+		&FUPBulkRenameModule::RegisterMenus));
 
 	// Register plugin setting
 	if (ISettingsModule* SettingsModule = FModuleManager::GetModulePtr<ISettingsModule>("Settings"))
@@ -49,10 +57,56 @@ void FUPBulkRenameModule::StartupModule()
 		    GetMutableDefault<UUPBulkRenameSettings>()
 		);
 	}
+
+	// a rename batch left unfinished by a crash, offer to recover once assets are known
+	if (FUPRenameJournal::HasUnfinishedBatch())
+	{
+		PostEngineInitHandle = FCoreDelegates::OnPostEngineInit.AddRaw(this, &FUPBulkRenameModule::OnPostEngineInit);
+	}
 }
 
 void FUPBulkRenameModule::ShutdownModule()
 {
+	UToolMenus::UnRegisterStartupCallback(this);
+	UToolMenus::UnregisterOwner(this);
+	FCoreDelegates::OnPostEngineInit.Remove(PostEngineInitHandle);
+	if (IAssetRegistry* AssetRegistry = IAssetRegistry::Get())
+	{
+		AssetRegistry->OnFilesLoaded().Remove(FilesLoadedHandle);
+	}
+}
+
+void FUPBulkRenameModule::RegisterMenus()
+{
+	FToolMenuOwnerScoped OwnerScoped(this);
+	UToolMenu* ToolsMenu = UToolMenus::Get()->ExtendMenu("LevelEditor.MainMenu.Tools");
+	FToolMenuSection& Section = ToolsMenu->FindOrAddSection("UPBulkRename", LOCTEXT("ToolsSection", "UP Bulk Rename"));
+	Section.AddMenuEntry(
+		"UPBulkRenameActorQuery",
+		LOCTEXT("ActorQueryMenuTitle", "UP Bulk Rename actors by query..."),
+		LOCTEXT("ActorQueryMenuTooltip", "Bulk rename the level's actors matching class, label, folder, data layer and tag filters"),
+		FSlateIcon(FUPBulkRenameStyle::GetStyleSetName(), "SmallIcon"),
+		FUIAction(FExecuteAction::CreateLambda([]()
+		{
+			if (GEditor)
+				SUPQueryDialog::Open(GEditor->GetEditorWorldContext().World());
+		}))
+	);
+}
+
+void FUPBulkRenameModule::OnPostEngineInit()
+{
+	IAssetRegistry& AssetRegistry = IAssetRegistry::GetChecked();
+	if (!AssetRegistry.IsLoadingAssets())
+	{
+		FUPRenameJournal::RecoverUnfinishedBatch();
+		return;
+	}
+	FilesLoadedHandle = AssetRegistry.OnFilesLoaded().AddLambda([this]()
+	{
+		IAssetRegistry::GetChecked().OnFilesLoaded().Remove(FilesLoadedHandle);
+		FUPRenameJournal::RecoverUnfinishedBatch();
+	});
 }
 
 TSharedRef<FExtender> FUPBulkRenameModule::PathMenuExtender(const TArray<FString>& SelectedPaths)
@@ -75,6 +129,16 @@ TSharedRef<FExtender> FUPBulkRenameModule::PathMenuExtender(const TArray<FString
 					SUPDialog::Open(SelectedPaths, true);
 				})
 			);
+			MenuBuilder.AddMenuEntry
+			(
+				LOCTEXT("QueryMenuTitle", "UP Bulk Rename by query..."),
+				LOCTEXT("QueryMenuTooltip", "Bulk rename assets under these folders matching class, name and tag filters"),
+				FSlateIcon(FUPBulkRenameStyle::GetStyleSetName(), "SmallIcon"),
+				FExecuteAction::CreateLambda([=, this]()
+				{
+					SUPQueryDialog::Open(SelectedPaths);
+				})
+			);
 		})
 		);
 	return Extender;
@@ -134,6 +198,30 @@ TSharedRef<FExtender> FUPBulkRenameModule::LevelEditorMenuExtender(
 						SUPDialog::Open(SelectedActors);
 					})
 				);
+				UWorld* World = SelectedActors[0]->GetWorld();
+				MenuBuilder.AddMenuEntry(
+					LOCTEXT("ActorQueryActionTitle", "UP Bulk Rename actors by query..."),
+					LOCTEXT("ActorQueryActionTooltip", "Bulk rename the level's actors matching class, label, folder, data layer and tag filters"),
+					FSlateIcon(FUPBulkRenameStyle::GetStyleSetName(), "SmallIcon"),
+					FExecuteAction::CreateLambda([WeakWorld = TWeakObjectPtr<UWorld>(World)]()
+					{
+						if (UWorld* World = WeakWorld.Get())
+							SUPQueryDialog::Open(World);
+					})
+				);
+				if (World && World->IsPartitionedWorld())
+				{
+					MenuBuilder.AddMenuEntry(
+						LOCTEXT("WorldActorActionTitle", "UP Bulk Rename all actors in world"),
+						LOCTEXT("WorldActorActionTooltip", "Bulk rename every actor of this world partition, loaded or not"),
+						FSlateIcon(FUPBulkRenameStyle::GetStyleSetName(), "SmallIcon"),
+						FExecuteAction::CreateLambda([WeakWorld = TWeakObjectPtr<UWorld>(World)]()
+						{
+							if (UWorld* World = WeakWorld.Get())
+								SUPDialog::Open(World);
+						})
+					);
+				}
 			})
 		);
 	}
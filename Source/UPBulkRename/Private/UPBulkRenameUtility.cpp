@@ -6,10 +6,14 @@
 #include "Framework/Notifications/NotificationManager.h"
 #include "Widgets/Notifications/SNotificationList.h"
 
-#include <filesystem>
+#include <atomic>
 
+#include "Async/ParallelFor.h"
+#include "HAL/PlatformFileManager.h"
 #include "Interfaces/IPluginManager.h"
-#include "Kismet/KismetSystemLibrary.h"
+#include "Misc/Paths.h"
+#include "UPPackagePathResolver.h"
+#include "UPPerforceConnection.h"
 
 void UUPBulkRenameUtility::StopSourceControl()
 {
@@ -42,41 +46,128 @@ void UUPBulkRenameUtility::RunScript(FString ScriptName, FString Parameters, boo
 
 void UUPBulkRenameUtility::SystemRename(const FString& OldName, const FString& NewName)
 {
-	if (!std::filesystem::exists(TCHAR_TO_ANSI(*OldName)))
+	TArray<FString> Errors;
+	if (SystemRenameBatch({ { OldName, NewName } }, &Errors) > 0)
 	{
-		NotifyError(FText::FromString("Source file not exist"));
-		return;
+		NotifyError(FText::FromString(Errors[0]));
 	}
-	std::filesystem::path TargetPath = std::filesystem::path(TCHAR_TO_ANSI(*NewName)).parent_path();
-	std::filesystem::create_directories(TargetPath);
-	std::filesystem::rename(TCHAR_TO_ANSI(*OldName), TCHAR_TO_ANSI(*NewName));
 }
 
-FString UUPBulkRenameUtility::MakeSysPath(const FString& Path, bool IsFolder, bool IsPkgName)
+int32 UUPBulkRenameUtility::SystemRenameBatch(const TArray<TPair<FString, FString>>& Moves, TArray<FString>* OutErrors,
+	TArray<bool>* OutMoved)
 {
-	FString Out = UKismetSystemLibrary::GetProjectDirectory();
-	FString Temp = Path.Mid(1, Path.Len());
-	FString Left, Right;
-	Temp.Split(TEXT("/"), &Left, &Right, ESearchCase::IgnoreCase, ESearchDir::FromStart);
-	if (Left == TEXT("Game"))
+	if (OutMoved)
 	{
-		Out += "Content/" + Right;
+		// one byte per move, workers never share a word
+		OutMoved->Init(false, Moves.Num());
 	}
-	else
+	if (Moves.IsEmpty())
+	{
+		return 0;
+	}
+	IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+
+	// create every target directory once instead of once per file
+	TSet<FString> TargetDirs;
+	for (const TPair<FString, FString>& Move : Moves)
+	{
+		TargetDirs.Add(FPaths::GetPath(Move.Value));
+	}
+	for (const FString& Dir : TargetDirs)
+	{
+		PlatformFile.CreateDirectoryTree(*Dir);
+	}
+
+	// a few workers pull from a shared index, renames are independent so order does not matter
+	constexpr int32 MaxIOWorkers = 8;
+	constexpr int32 MovesPerWorker = 32;
+	const int32 NumWorkers = FMath::Clamp(Moves.Num() / MovesPerWorker, 1, MaxIOWorkers);
+	std::atomic<int32> NextMove = 0;
+	TArray<TArray<FString>> WorkerErrors;
+	WorkerErrors.SetNum(NumWorkers);
+	ParallelFor(NumWorkers, [&](int32 Worker)
+	{
+		for (int32 i = NextMove++; i < Moves.Num(); i = NextMove++)
+		{
+			const FString& From = Moves[i].Key;
+			const FString& To = Moves[i].Value;
+			if (PlatformFile.MoveFile(*To, *From))
+			{
+				if (OutMoved)
+					(*OutMoved)[i] = true;
+				continue;
+			}
+			// before any other file call overwrites it
+			uint32 ErrorCode = FPlatformMisc::GetLastError();
+			// only pay for the extra checks on the slow path
+			if (!PlatformFile.FileExists(*From))
+			{
+				WorkerErrors[Worker].Add(FString::Printf(TEXT("Source file not exist: %s"), *From));
+				continue;
+			}
+			if (PlatformFile.FileExists(*To) && PlatformFile.DeleteFile(*To))
+			{
+				if (PlatformFile.MoveFile(*To, *From))
+				{
+					if (OutMoved)
+						(*OutMoved)[i] = true;
+					continue;
+				}
+				ErrorCode = FPlatformMisc::GetLastError();
+			}
+			TCHAR SystemError[512];
+			FPlatformMisc::GetSystemErrorMessage(SystemError, UE_ARRAY_COUNT(SystemError), ErrorCode);
+			WorkerErrors[Worker].Add(FString::Printf(TEXT("Can not move %s to %s: %s"), *From, *To, SystemError));
+		}
+	}, NumWorkers == 1 ? EParallelForFlags::ForceSingleThread : EParallelForFlags::None);
+
+	int32 NumFailed = 0;
+	for (const TArray<FString>& Errors : WorkerErrors)
 	{
-		Out += "Plugins/" + Left + "/Content/" + Right;
+		for (const FString& Error : Errors)
+		{
+			UE_LOG(LogUPBulkRename, Error, TEXT("%s"), *Error);
+		}
+		NumFailed += Errors.Num();
+		if (OutErrors)
+		{
+			OutErrors->Append(Errors);
+		}
 	}
-	if (IsPkgName)
+	return NumFailed;
+}
+
+bool UUPBulkRenameUtility::SystemMoveDirectory(const FString& FromDir, const FString& ToDir)
+{
+	IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+	if (!PlatformFile.DirectoryExists(*FromDir) || PlatformFile.DirectoryExists(*ToDir))
 	{
-		Out += TEXT(".uasset");
-		return Out;
+		UE_LOG(LogUPBulkRename, Error, TEXT("Can not move %s to %s: source missing or target exists"), *FromDir, *ToDir);
+		return false;
 	}
-	if (!IsFolder)
+	PlatformFile.CreateDirectoryTree(*FPaths::GetPath(ToDir));
+	if (!PlatformFile.MoveFile(*ToDir, *FromDir))
+	{
+		const uint32 ErrorCode = FPlatformMisc::GetLastError();
+		TCHAR SystemError[512];
+		FPlatformMisc::GetSystemErrorMessage(SystemError, UE_ARRAY_COUNT(SystemError), ErrorCode);
+		UE_LOG(LogUPBulkRename, Error, TEXT("Can not move %s to %s: %s"), *FromDir, *ToDir, SystemError);
+		return false;
+	}
+	return true;
+}
+
+FString UUPBulkRenameUtility::MakeSysPath(const FString& Path, bool IsFolder)
+{
+	TStringBuilder<512> Out;
+	const bool bResolved = IsFolder ?
+		FUPPackagePathResolver::Get().AppendFolderPath(Path, Out) :
+		FUPPackagePathResolver::Get().AppendPackageFilename(Path, Out);
+	if (!bResolved)
 	{
-		Out.Split(".", &Left, &Right, ESearchCase::IgnoreCase, ESearchDir::FromEnd);
-		Out = Left + TEXT(".uasset");
+		UE_LOG(LogUPBulkRename, Warning, TEXT("%s is not under any mounted content root"), *Path);
 	}
-	return Out;
+	return FString(Out.ToView());
 }
 
 void UUPBulkRenameUtility::NotifySuccess(FText Message, FString HyperLinkURL,
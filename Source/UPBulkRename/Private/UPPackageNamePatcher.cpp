@@ -0,0 +1,865 @@
+// Copyright 2024 PufStudio. All Rights Reserved.
+
+#include "UPPackageNamePatcher.h"
+
+#include "HAL/FileManager.h"
+#include "HAL/PlatformFileManager.h"
+#include "Async/MappedFileHandle.h"
+#include "Misc/FileHelper.h"
+#include "Misc/PackageName.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+#include "UObject/ObjectResource.h"
+#include "UObject/PackageFileSummary.h"
+
+namespace UPPackageNamePatcher
+{
+	/** newest UE5 package version whose summary offsets WriteHeader knows (5.4), whatever engine the plugin is built against */
+	constexpr int32 LastKnownFileVersionUE5 = int32(EUnrealEngineObjectUE5Version::PROPERTY_TAG_COMPLETE_TYPE_NAME);
+
+	/** a rewritten piece of the old file, an empty old range is an insertion */
+	struct FRegion
+	{
+		int64 OldStart = 0;
+		int64 OldEnd = 0;
+		TArray<uint8> NewBytes;
+	};
+
+	/** old file offset -> new file offset, regions sorted and not overlapping, absent sections (<= 0) stay absent */
+	int64 MapOffset(const TArray<FRegion>& Regions, int64 Offset)
+	{
+		if (Offset <= 0)
+		{
+			return Offset;
+		}
+		int64 Delta = 0;
+		for (const FRegion& Region : Regions)
+		{
+			// a section starting right where an insertion happens moves behind it
+			if (Region.OldEnd > Offset)
+			{
+				break;
+			}
+			Delta += Region.NewBytes.Num() - (Region.OldEnd - Region.OldStart);
+		}
+		return Offset + Delta;
+	}
+
+	/** reads the header the way the linker does, FNames are name map indices */
+	class FHeaderReader : public FMemoryReaderView
+	{
+	public:
+		struct FNameRef
+		{
+			int64 Position;
+			int32 Index;
+		};
+
+		explicit FHeaderReader(TConstArrayView<uint8> Bytes)
+			: FMemoryReaderView(Bytes, true)
+		{
+		}
+
+		using FMemoryReaderView::operator<<;
+		virtual FArchive& operator<<(FName& Name) override
+		{
+			FNameRef& Ref = NameRefs.AddDefaulted_GetRef();
+			Ref.Position = Tell();
+			int32 Number = 0;
+			*this << Ref.Index << Number;
+			// only the index matters here, nothing is added to the global name table
+			Name = NAME_None;
+			return *this;
+		}
+
+		TArray<FNameRef> NameRefs;
+	};
+
+	struct FNameEntry
+	{
+		FString Name;
+		uint16 Hashes[2];
+	};
+
+	/** /Old/Folder/... -> /New/Folder/..., whole path segments only */
+	bool RemapPath(FString& Path, TConstArrayView<TPair<FString, FString>> FolderRemaps)
+	{
+		for (const TPair<FString, FString>& Remap : FolderRemaps)
+		{
+			if (Path.StartsWith(Remap.Key, ESearchCase::IgnoreCase) &&
+				(Path.Len() == Remap.Key.Len() || Path[Remap.Key.Len()] == TEXT('/')))
+			{
+				Path = Remap.Value + Path.RightChop(Remap.Key.Len());
+				return true;
+			}
+		}
+		return false;
+	}
+
+	struct FExportRef
+	{
+		int64 NamePosition;
+		int32 NameIndex;
+		int64 SerialOffset;
+		bool bTopLevel;
+	};
+
+	struct FThumbnailRef
+	{
+		FString ClassName;
+		FString ObjectPath;
+		int32 FileOffset;
+	};
+
+	struct FAssetDataRef
+	{
+		FString ObjectPath;
+		FString ClassName;
+		TArray<TPair<FString, FString>> Tags;
+	};
+
+	/** object path relative to the package: Asset, Asset.Sub or Asset:Sub */
+	bool RenameRelativePath(FString& Path, const FString& OldAssetName, const FString& NewAssetName)
+	{
+		if (Path == OldAssetName)
+		{
+			Path = NewAssetName;
+			return true;
+		}
+		if (Path.StartsWith(OldAssetName, ESearchCase::CaseSensitive) &&
+			(Path[OldAssetName.Len()] == TEXT('.') || Path[OldAssetName.Len()] == TEXT(':')))
+		{
+			Path = NewAssetName + Path.RightChop(OldAssetName.Len());
+			return true;
+		}
+		return false;
+	}
+
+	void WriteInt64(TArray<uint8>& Bytes, int64 Position, int64 Value)
+	{
+		FMemory::Memcpy(Bytes.GetData() + Position, &Value, sizeof(Value));
+	}
+
+	/** export map entry: name, flags (uint32), serial size (int64), serial offset (int64) */
+	int64 GetSerialOffsetPosition(const FExportRef& Export)
+	{
+		return Export.NamePosition + 2 * sizeof(int32) + sizeof(uint32) + sizeof(int64);
+	}
+
+	/** the header sections the patcher understands, edited by the caller and written back by WriteHeader */
+	struct FHeader
+	{
+		FPackageFileSummary Summary;
+		int64 SummarySize = 0;
+		TArray<FNameEntry> NameEntries;
+		int32 NumOldNames = 0;
+		int64 NameEnd = 0;
+		/** an existing entry changed, the whole name map is written again */
+		bool bNamesRewritten = false;
+		TArray<FExportRef> Exports;
+		TArray<FThumbnailRef> Thumbnails;
+		int64 ThumbnailTableEnd = 0;
+		TArray<FAssetDataRef> AssetDatas;
+		int64 DependencyDataOffset = -1;
+		bool bHasDependencyDataOffset = false;
+		int64 AssetDataEnd = 0;
+		/** fixed size name references (export, import or soft path names) to point at another name map entry */
+		TArray<TPair<int64, int32>> NameIndexPatches;
+
+		/** appended when missing, so any other use of the existing names stays valid */
+		int32 FindOrAddName(const FString& Name)
+		{
+			const int32 Index = NameEntries.IndexOfByPredicate([&Name](const FNameEntry& Entry) { return Entry.Name.Equals(Name, ESearchCase::CaseSensitive); });
+			if (Index != INDEX_NONE)
+			{
+				return Index;
+			}
+			// the loader skips the hashes
+			FNameEntry& Entry = NameEntries.AddDefaulted_GetRef();
+			Entry.Name = Name;
+			Entry.Hashes[0] = Entry.Hashes[1] = 0;
+			return NameEntries.Num() - 1;
+		}
+	};
+
+	/** summary, name map, export map, thumbnails and asset registry data, refuses anything with absolute offsets it can not fix */
+	bool ReadHeader(TConstArrayView<uint8> Source, FHeaderReader& Reader, FHeader& Header, FString& OutReason)
+	{
+		FPackageFileSummary& Summary = Header.Summary;
+		Reader << Summary;
+		Header.SummarySize = Reader.Tell();
+		if (Reader.IsError() || Summary.Tag != PACKAGE_FILE_TAG)
+		{
+			OutReason = TEXT("not a package file");
+			return false;
+		}
+		if (Summary.bUnversioned || Summary.IsFileVersionTooOld() || Summary.IsFileVersionTooNew()
+			|| Summary.GetFileVersionUE() < VER_UE4_NAME_HASHES_SERIALIZED)
+		{
+			OutReason = TEXT("unversioned or unsupported package version");
+			return false;
+		}
+		if (Summary.GetFileVersionUE().FileVersionUE5 > LastKnownFileVersionUE5)
+		{
+			// a newer summary may carry offsets the remap does not know about
+			OutReason = TEXT("package saved by a newer engine than the patcher knows");
+			return false;
+		}
+		if (Summary.GetPackageFlags() & (PKG_FilterEditorOnly | PKG_UnversionedProperties))
+		{
+			OutReason = TEXT("cooked package");
+			return false;
+		}
+		Reader.SetUEVer(Summary.GetFileVersionUE());
+		Reader.SetLicenseeUEVer(Summary.GetFileVersionLicenseeUE());
+		Reader.SetCustomVersions(Summary.GetCustomVersionContainer());
+
+		// bulk data stored at the end of the file is addressed by absolute offsets inside export data
+		const int64 BulkDataEnd = Summary.PayloadTocOffset > 0 ? Summary.PayloadTocOffset : Source.Num() - int64(sizeof(uint32));
+		if (Summary.BulkDataStartOffset > 0 && BulkDataEnd - Summary.BulkDataStartOffset > int64(sizeof(uint32)))
+		{
+			OutReason = TEXT("package has legacy bulk data");
+			return false;
+		}
+		if (Summary.DataResourceOffset > 0)
+		{
+			Reader.Seek(Summary.DataResourceOffset);
+			uint32 Version = 0;
+			int32 NumDataResources = 0;
+			Reader << Version << NumDataResources;
+			if (NumDataResources > 0)
+			{
+				OutReason = TEXT("package has bulk data resources");
+				return false;
+			}
+		}
+
+		// name map
+		Header.NameEntries.Reserve(Summary.NameCount + 1);
+		Reader.Seek(Summary.NameOffset);
+		for (int32 i = 0; i < Summary.NameCount && !Reader.IsError(); i++)
+		{
+			FNameEntry& Entry = Header.NameEntries.AddDefaulted_GetRef();
+			Reader << Entry.Name << Entry.Hashes[0] << Entry.Hashes[1];
+		}
+		Header.NumOldNames = Header.NameEntries.Num();
+		Header.NameEnd = Reader.Tell();
+		if (Reader.IsError())
+		{
+			OutReason = TEXT("can not read the name map");
+			return false;
+		}
+
+		// export map, only the names and serial offsets are touched
+		Reader.Seek(Summary.ExportOffset);
+		for (int32 i = 0; i < Summary.ExportCount && !Reader.IsError(); i++)
+		{
+			Reader.NameRefs.Reset();
+			FObjectExport Export;
+			Reader << Export;
+			if (Reader.NameRefs.Num() != 1 || !Header.NameEntries.IsValidIndex(Reader.NameRefs[0].Index))
+			{
+				OutReason = TEXT("unknown export map layout");
+				return false;
+			}
+			FExportRef& Ref = Header.Exports.AddDefaulted_GetRef();
+			Ref.NamePosition = Reader.NameRefs[0].Position;
+			Ref.NameIndex = Reader.NameRefs[0].Index;
+			Ref.SerialOffset = Export.SerialOffset;
+			Ref.bTopLevel = Export.OuterIndex.IsNull();
+
+			int64 StoredOffset = 0;
+			FMemory::Memcpy(&StoredOffset, Source.GetData() + GetSerialOffsetPosition(Ref), sizeof(StoredOffset));
+			if (StoredOffset != Ref.SerialOffset)
+			{
+				OutReason = TEXT("unknown export map layout");
+				return false;
+			}
+		}
+		if (Reader.IsError())
+		{
+			OutReason = TEXT("can not read the export map");
+			return false;
+		}
+
+		// thumbnail table
+		if (Summary.ThumbnailTableOffset > 0)
+		{
+			Reader.Seek(Summary.ThumbnailTableOffset);
+			int32 NumThumbnails = 0;
+			Reader << NumThumbnails;
+			for (int32 i = 0; i < NumThumbnails && !Reader.IsError(); i++)
+			{
+				FThumbnailRef& Thumbnail = Header.Thumbnails.AddDefaulted_GetRef();
+				Reader << Thumbnail.ClassName << Thumbnail.ObjectPath << Thumbnail.FileOffset;
+			}
+			Header.ThumbnailTableEnd = Reader.Tell();
+		}
+
+		// asset registry data, the dependency data behind it is copied as is
+		Header.bHasDependencyDataOffset = Summary.GetFileVersionUE() >= VER_UE4_ASSETREGISTRY_DEPENDENCYFLAGS;
+		if (Summary.AssetRegistryDataOffset > 0)
+		{
+			Reader.Seek(Summary.AssetRegistryDataOffset);
+			if (Header.bHasDependencyDataOffset)
+			{
+				Reader << Header.DependencyDataOffset;
+			}
+			int32 NumAssetDatas = 0;
+			Reader << NumAssetDatas;
+			for (int32 i = 0; i < NumAssetDatas && !Reader.IsError(); i++)
+			{
+				FAssetDataRef& AssetData = Header.AssetDatas.AddDefaulted_GetRef();
+				int32 NumTags = 0;
+				Reader << AssetData.ObjectPath << AssetData.ClassName << NumTags;
+				for (int32 Tag = 0; Tag < NumTags && !Reader.IsError(); Tag++)
+				{
+					TPair<FString, FString>& Pair = AssetData.Tags.AddDefaulted_GetRef();
+					Reader << Pair.Key << Pair.Value;
+				}
+			}
+			Header.AssetDataEnd = Reader.Tell();
+		}
+		if (Reader.IsError())
+		{
+			OutReason = TEXT("can not read the header tables");
+			return false;
+		}
+		return true;
+	}
+
+	/** splice the edited sections into a copy of the source, every absolute offset behind them is shifted */
+	bool WriteHeader(TConstArrayView<uint8> Source, const FHeader& Header, TArray<uint8>& OutPatched, FString& OutReason)
+	{
+		const FPackageFileSummary& Summary = Header.Summary;
+		const bool bAppendNames = Header.NameEntries.Num() > Header.NumOldNames;
+
+		// sizes do not depend on offset values, so build once to measure, then again with the final mapping
+		auto BuildRegions = [&](TFunctionRef<int64(int64)> Map)
+		{
+			TArray<FRegion> Regions;
+			auto Map32 = [&Map](int32 Offset) { return IntCastChecked<int32>(Map(Offset)); };
+			{
+				FPackageFileSummary NewSummary = Summary;
+				if (bAppendNames)
+				{
+					NewSummary.NameCount = Header.NameEntries.Num();
+					if (NewSummary.Generations.Num() > 0)
+					{
+						NewSummary.Generations.Last().NameCount = NewSummary.NameCount;
+					}
+				}
+				NewSummary.TotalHeaderSize = Map32(Summary.TotalHeaderSize);
+				NewSummary.NameOffset = Map32(Summary.NameOffset);
+				NewSummary.SoftObjectPathsOffset = Map32(Summary.SoftObjectPathsOffset);
+				NewSummary.GatherableTextDataOffset = Map32(Summary.GatherableTextDataOffset);
+				NewSummary.ExportOffset = Map32(Summary.ExportOffset);
+				NewSummary.ImportOffset = Map32(Summary.ImportOffset);
+				NewSummary.DependsOffset = Map32(Summary.DependsOffset);
+				NewSummary.SoftPackageReferencesOffset = Map32(Summary.SoftPackageReferencesOffset);
+				NewSummary.SearchableNamesOffset = Map32(Summary.SearchableNamesOffset);
+				NewSummary.ThumbnailTableOffset = Map32(Summary.ThumbnailTableOffset);
+				NewSummary.AssetRegistryDataOffset = Map32(Summary.AssetRegistryDataOffset);
+				NewSummary.BulkDataStartOffset = Map(Summary.BulkDataStartOffset);
+				NewSummary.WorldTileInfoDataOffset = Map32(Summary.WorldTileInfoDataOffset);
+				NewSummary.PreloadDependencyOffset = Map32(Summary.PreloadDependencyOffset);
+				NewSummary.DataResourceOffset = Map32(Summary.DataResourceOffset);
+				NewSummary.PayloadTocOffset = Map(Summary.PayloadTocOffset);
+
+				FRegion& Region = Regions.AddDefaulted_GetRef();
+				Region.OldStart = 0;
+				Region.OldEnd = Header.SummarySize;
+				FMemoryWriter Writer(Region.NewBytes);
+				Writer << NewSummary;
+			}
+			if (Header.bNamesRewritten || bAppendNames)
+			{
+				// rewritten entries change size, then the whole map is written again, otherwise new names are inserted
+				FRegion& Region = Regions.AddDefaulted_GetRef();
+				Region.OldStart = Header.bNamesRewritten ? Summary.NameOffset : Header.NameEnd;
+				Region.OldEnd = Header.NameEnd;
+				FMemoryWriter Writer(Region.NewBytes);
+				for (int32 i = Header.bNamesRewritten ? 0 : Header.NumOldNames; i < Header.NameEntries.Num(); i++)
+				{
+					FNameEntry Entry = Header.NameEntries[i];
+					Writer << Entry.Name << Entry.Hashes[0] << Entry.Hashes[1];
+				}
+			}
+			if (Summary.ThumbnailTableOffset > 0)
+			{
+				FRegion& Region = Regions.AddDefaulted_GetRef();
+				Region.OldStart = Summary.ThumbnailTableOffset;
+				Region.OldEnd = Header.ThumbnailTableEnd;
+				FMemoryWriter Writer(Region.NewBytes);
+				int32 NumThumbnails = Header.Thumbnails.Num();
+				Writer << NumThumbnails;
+				for (FThumbnailRef Thumbnail : Header.Thumbnails)
+				{
+					Thumbnail.FileOffset = Map32(Thumbnail.FileOffset);
+					Writer << Thumbnail.ClassName << Thumbnail.ObjectPath << Thumbnail.FileOffset;
+				}
+			}
+			if (Summary.AssetRegistryDataOffset > 0)
+			{
+				FRegion& Region = Regions.AddDefaulted_GetRef();
+				Region.OldStart = Summary.AssetRegistryDataOffset;
+				Region.OldEnd = Header.AssetDataEnd;
+				FMemoryWriter Writer(Region.NewBytes);
+				if (Header.bHasDependencyDataOffset)
+				{
+					int64 NewDependencyDataOffset = Map(Header.DependencyDataOffset);
+					Writer << NewDependencyDataOffset;
+				}
+				int32 NumAssetDatas = Header.AssetDatas.Num();
+				Writer << NumAssetDatas;
+				for (FAssetDataRef AssetData : Header.AssetDatas)
+				{
+					int32 NumTags = AssetData.Tags.Num();
+					Writer << AssetData.ObjectPath << AssetData.ClassName << NumTags;
+					for (TPair<FString, FString>& Tag : AssetData.Tags)
+					{
+						Writer << Tag.Key << Tag.Value;
+					}
+				}
+			}
+			Regions.Sort([](const FRegion& A, const FRegion& B) { return A.OldStart < B.OldStart; });
+			return Regions;
+		};
+		const TArray<FRegion> Measured = BuildRegions([](int64 Offset) { return Offset; });
+		const TArray<FRegion> Regions = BuildRegions([&Measured](int64 Offset) { return MapOffset(Measured, Offset); });
+
+		// fixed size entries are patched in a copy of the old bytes
+		TArray<uint8> Bytes(Source.GetData(), Source.Num());
+		for (const TPair<int64, int32>& Patch : Header.NameIndexPatches)
+		{
+			FMemory::Memcpy(Bytes.GetData() + Patch.Key, &Patch.Value, sizeof(Patch.Value));
+		}
+		for (const FExportRef& Export : Header.Exports)
+		{
+			WriteInt64(Bytes, GetSerialOffsetPosition(Export), MapOffset(Regions, Export.SerialOffset));
+		}
+
+		OutPatched.Reset(Bytes.Num() + 1024);
+		int64 Cursor = 0;
+		for (const FRegion& Region : Regions)
+		{
+			OutPatched.Append(Bytes.GetData() + Cursor, Region.OldStart - Cursor);
+			OutPatched.Append(Region.NewBytes);
+			Cursor = Region.OldEnd;
+		}
+		OutPatched.Append(Bytes.GetData() + Cursor, Bytes.Num() - Cursor);
+
+		// the header must read back as the expected package
+		FMemoryReader Check(OutPatched, true);
+		FPackageFileSummary NewSummary;
+		Check << NewSummary;
+		if (Check.IsError() || NewSummary.PackageName != Summary.PackageName || NewSummary.TotalHeaderSize > OutPatched.Num()
+			|| OutPatched.Num() - NewSummary.TotalHeaderSize != Source.Num() - Summary.TotalHeaderSize)
+		{
+			OutReason = TEXT("patched header does not read back");
+			return false;
+		}
+		return true;
+	}
+
+	/** map the file instead of copying it in, export data is only read once; the target is written next to itself and swapped in */
+	bool PatchFileWith(const FString& SourceFile, const FString& TargetFile, FString& OutReason,
+		TFunctionRef<bool(TConstArrayView<uint8>, TArray<uint8>&)> Patch)
+	{
+		TArray<uint8> Patched;
+		{
+			TUniquePtr<IMappedFileHandle> MappedFile(FPlatformFileManager::Get().GetPlatformFile().OpenMapped(*SourceFile));
+			TUniquePtr<IMappedFileRegion> MappedRegion(MappedFile ? MappedFile->MapRegion() : nullptr);
+			TArray<uint8> Loaded;
+			TConstArrayView<uint8> Source;
+			if (MappedRegion)
+			{
+				Source = TConstArrayView<uint8>(MappedRegion->GetMappedPtr(), MappedRegion->GetMappedSize());
+			}
+			else if (FFileHelper::LoadFileToArray(Loaded, *SourceFile))
+			{
+				Source = Loaded;
+			}
+			else
+			{
+				OutReason = TEXT("can not read ") + SourceFile;
+				return false;
+			}
+			if (!Patch(Source, Patched))
+			{
+				return false;
+			}
+		}
+
+		IFileManager& FileManager = IFileManager::Get();
+		const FString TempFile = TargetFile + TEXT(".uptmp");
+		if (!FFileHelper::SaveArrayToFile(Patched, *TempFile))
+		{
+			OutReason = TEXT("can not write ") + TempFile;
+			return false;
+		}
+		if (!FileManager.Move(*TargetFile, *TempFile, true, true))
+		{
+			FileManager.Delete(*TempFile);
+			OutReason = TEXT("can not write ") + TargetFile;
+			return false;
+		}
+		return true;
+	}
+
+	/** read the header and make every edit of the rename, refused packages return false */
+	bool PrepareRename(TConstArrayView<uint8> Source, FHeader& Header, const FString& OldPackageName, const FString& NewPackageName,
+		FString& OutReason, TConstArrayView<TPair<FString, FString>> FolderRemaps)
+	{
+		const FString OldAssetName = FPackageName::GetShortName(OldPackageName);
+		const FString NewAssetName = FPackageName::GetShortName(NewPackageName);
+
+		FHeaderReader Reader(Source);
+		if (!ReadHeader(Source, Reader, Header, OutReason))
+		{
+			return false;
+		}
+		if (Header.Summary.GetPackageFlags() & PKG_ContainsMap)
+		{
+			OutReason = TEXT("map package");
+			return false;
+		}
+		if (!Header.Summary.PackageName.Equals(OldPackageName, ESearchCase::IgnoreCase))
+		{
+			OutReason = FString::Printf(TEXT("saved as %s"), *Header.Summary.PackageName);
+			return false;
+		}
+
+		bool bFoundAsset = false;
+		for (const FExportRef& Export : Header.Exports)
+		{
+			if (!Export.bTopLevel)
+			{
+				continue;
+			}
+			const FString& ExportName = Header.NameEntries[Export.NameIndex].Name;
+			if (ExportName == OldAssetName)
+			{
+				bFoundAsset = true;
+			}
+			else if (OldAssetName != NewAssetName && ExportName.Contains(OldAssetName))
+			{
+				// generated class, default object... named after the asset
+				OutReason = FString::Printf(TEXT("export %s is named after the asset"), *ExportName);
+				return false;
+			}
+		}
+		if (!bFoundAsset)
+		{
+			OutReason = TEXT("no export named after the package");
+			return false;
+		}
+
+		for (FNameEntry& Entry : Header.NameEntries)
+		{
+			// paths into a moved folder (imports of its packages, soft paths) follow it
+			if (RemapPath(Entry.Name, FolderRemaps))
+			{
+				Header.bNamesRewritten = true;
+				Entry.Hashes[0] = Entry.Hashes[1] = 0;
+			}
+			// something refers to the package by path (soft self reference, redirect), that needs a real rename
+			else if (Entry.Name.Equals(OldPackageName, ESearchCase::IgnoreCase))
+			{
+				OutReason = TEXT("package refers to itself by path");
+				return false;
+			}
+		}
+		for (FAssetDataRef& AssetData : Header.AssetDatas)
+		{
+			RenameRelativePath(AssetData.ObjectPath, OldAssetName, NewAssetName);
+			for (TPair<FString, FString>& Tag : AssetData.Tags)
+			{
+				for (const TPair<FString, FString>& Remap : FolderRemaps)
+				{
+					Tag.Value.ReplaceInline(*(Remap.Key + TEXT("/")), *(Remap.Value + TEXT("/")), ESearchCase::IgnoreCase);
+				}
+				if (Tag.Value.Contains(OldPackageName))
+				{
+					OutReason = FString::Printf(TEXT("tag %s refers to the package by path"), *Tag.Key);
+					return false;
+				}
+			}
+		}
+		for (FThumbnailRef& Thumbnail : Header.Thumbnails)
+		{
+			RenameRelativePath(Thumbnail.ObjectPath, OldAssetName, NewAssetName);
+		}
+
+		// the asset export points at the new name, any other use of the old one stays valid
+		const int32 NewNameIndex = Header.FindOrAddName(NewAssetName);
+		for (const FExportRef& Export : Header.Exports)
+		{
+			if (Export.bTopLevel && Export.NameIndex < Header.NumOldNames && Header.NameEntries[Export.NameIndex].Name == OldAssetName)
+			{
+				Header.NameIndexPatches.Emplace(Export.NamePosition, NewNameIndex);
+			}
+		}
+		Header.Summary.PackageName = NewPackageName;
+		return true;
+	}
+}
+
+bool FUPPackageNamePatcher::PatchPackage(TConstArrayView<uint8> Source, const FString& OldPackageName,
+	const FString& NewPackageName, TArray<uint8>& OutPatched, FString& OutReason,
+	TConstArrayView<TPair<FString, FString>> FolderRemaps)
+{
+	using namespace UPPackageNamePatcher;
+	FHeader Header;
+	if (!PrepareRename(Source, Header, OldPackageName, NewPackageName, OutReason, FolderRemaps))
+	{
+		return false;
+	}
+	return WriteHeader(Source, Header, OutPatched, OutReason);
+}
+
+bool FUPPackageNamePatcher::PatchReferences(TConstArrayView<uint8> Source, const TMap<FString, FString>& PackageRenames,
+	TArray<uint8>& OutPatched, FString& OutReason)
+{
+	using namespace UPPackageNamePatcher;
+	FHeaderReader Reader(Source);
+	FHeader Header;
+	if (!ReadHeader(Source, Reader, Header, OutReason))
+	{
+		return false;
+	}
+
+	// package paths and full object paths into renamed packages follow them
+	TArray<FString> OldNames;
+	OldNames.Reserve(Header.NumOldNames);
+	TMap<int32, TPair<FString, FString>> RenamedPackageNames;
+	for (int32 i = 0; i < Header.NumOldNames; i++)
+	{
+		FNameEntry& Entry = Header.NameEntries[i];
+		OldNames.Add(Entry.Name);
+		if (!Entry.Name.StartsWith(TEXT("/")))
+		{
+			continue;
+		}
+		FString PackageName = Entry.Name;
+		FString ObjectPath;
+		Entry.Name.Split(TEXT("."), &PackageName, &ObjectPath);
+		const FString* NewPackageName = PackageRenames.Find(PackageName);
+		if (!NewPackageName)
+		{
+			continue;
+		}
+		if (ObjectPath.IsEmpty())
+		{
+			RenamedPackageNames.Add(i, TPair<FString, FString>(PackageName, *NewPackageName));
+			Entry.Name = *NewPackageName;
+		}
+		else
+		{
+			const FString OldAssetName = FPackageName::GetShortName(PackageName);
+			const FString NewAssetName = FPackageName::GetShortName(*NewPackageName);
+			if (!RenameRelativePath(ObjectPath, OldAssetName, NewAssetName) && OldAssetName != NewAssetName && ObjectPath.Contains(OldAssetName))
+			{
+				OutReason = FString::Printf(TEXT("path %s is named after the asset"), *Entry.Name);
+				return false;
+			}
+			Entry.Name = *NewPackageName + TEXT(".") + ObjectPath;
+		}
+		Entry.Hashes[0] = Entry.Hashes[1] = 0;
+		Header.bNamesRewritten = true;
+	}
+	if (!Header.bNamesRewritten)
+	{
+		OutReason = TEXT("no reference to a renamed package");
+		return false;
+	}
+
+	// the asset name is a separate name map entry, only its import and soft path uses are pointed at the new one
+	auto RenamedAsset = [&RenamedPackageNames](int32 PackageNameIndex, FString& OutOldAssetName, FString& OutNewAssetName)
+	{
+		const TPair<FString, FString>* Rename = RenamedPackageNames.Find(PackageNameIndex);
+		if (!Rename)
+		{
+			return false;
+		}
+		OutOldAssetName = FPackageName::GetShortName(Rename->Key);
+		OutNewAssetName = FPackageName::GetShortName(Rename->Value);
+		return OutOldAssetName != OutNewAssetName;
+	};
+
+	struct FImportRef
+	{
+		int32 ClassPackage;
+		int32 ClassName;
+		int32 ObjectName;
+		int64 ObjectNamePosition;
+		int32 Outer;
+	};
+	TArray<FImportRef> Imports;
+	Imports.Reserve(Header.Summary.ImportCount);
+	Reader.Seek(Header.Summary.ImportOffset);
+	for (int32 i = 0; i < Header.Summary.ImportCount && !Reader.IsError(); i++)
+	{
+		// class package, class name, object name (and the optional package name)
+		Reader.NameRefs.Reset();
+		FObjectImport Import;
+		Reader << Import;
+		if (Reader.NameRefs.Num() < 3 || Reader.NameRefs.ContainsByPredicate([&Header](const FHeaderReader::FNameRef& Ref) { return !Header.NameEntries.IsValidIndex(Ref.Index); }))
+		{
+			OutReason = TEXT("unknown import map layout");
+			return false;
+		}
+		FImportRef& Ref = Imports.AddDefaulted_GetRef();
+		Ref.ClassPackage = Reader.NameRefs[0].Index;
+		Ref.ClassName = Reader.NameRefs[1].Index;
+		Ref.ObjectName = Reader.NameRefs[2].Index;
+		Ref.ObjectNamePosition = Reader.NameRefs[2].Position;
+		Ref.Outer = Import.OuterIndex.IsImport() ? Import.OuterIndex.ToImport() : INDEX_NONE;
+		if (Ref.Outer >= Header.Summary.ImportCount)
+		{
+			OutReason = TEXT("unknown import map layout");
+			return false;
+		}
+	}
+	if (Reader.IsError())
+	{
+		OutReason = TEXT("can not read the import map");
+		return false;
+	}
+	FString OldAssetName;
+	FString NewAssetName;
+	for (int32 i = 0; i < Imports.Num(); i++)
+	{
+		const FImportRef& Import = Imports[i];
+		// instances of a class generated from a renamed asset
+		if (RenamedAsset(Import.ClassPackage, OldAssetName, NewAssetName) && OldNames[Import.ClassName].Contains(OldAssetName))
+		{
+			OutReason = FString::Printf(TEXT("class %s is named after the asset"), *OldNames[Import.ClassName]);
+			return false;
+		}
+		int32 Outermost = i;
+		for (int32 Depth = 0; Imports[Outermost].Outer != INDEX_NONE && Depth < Imports.Num(); Depth++)
+		{
+			Outermost = Imports[Outermost].Outer;
+		}
+		if (Outermost == i || !RenamedAsset(Imports[Outermost].ObjectName, OldAssetName, NewAssetName))
+		{
+			continue;
+		}
+		const FString& ObjectName = OldNames[Import.ObjectName];
+		if (Import.Outer == Outermost && ObjectName == OldAssetName)
+		{
+			Header.NameIndexPatches.Emplace(Import.ObjectNamePosition, Header.FindOrAddName(NewAssetName));
+		}
+		else if (ObjectName.Contains(OldAssetName))
+		{
+			// generated class, default object... named after the asset
+			OutReason = FString::Printf(TEXT("import %s is named after the asset"), *ObjectName);
+			return false;
+		}
+	}
+
+	// soft object path list: package name, asset name, sub path
+	if (Header.Summary.SoftObjectPathsCount > 0 && Header.Summary.SoftObjectPathsOffset > 0)
+	{
+		Reader.Seek(Header.Summary.SoftObjectPathsOffset);
+		for (int32 i = 0; i < Header.Summary.SoftObjectPathsCount && !Reader.IsError(); i++)
+		{
+			Reader.NameRefs.Reset();
+			FName PackageName;
+			FName AssetName;
+			FString SubPath;
+			Reader << PackageName << AssetName << SubPath;
+			if (Reader.NameRefs.Num() != 2 || !OldNames.IsValidIndex(Reader.NameRefs[1].Index))
+			{
+				OutReason = TEXT("unknown soft object path layout");
+				return false;
+			}
+			if (!RenamedAsset(Reader.NameRefs[0].Index, OldAssetName, NewAssetName))
+			{
+				continue;
+			}
+			const FString& SoftAssetName = OldNames[Reader.NameRefs[1].Index];
+			if (SoftAssetName == OldAssetName)
+			{
+				Header.NameIndexPatches.Emplace(Reader.NameRefs[1].Position, Header.FindOrAddName(NewAssetName));
+			}
+			else if (SoftAssetName.Contains(OldAssetName))
+			{
+				OutReason = FString::Printf(TEXT("soft path to %s is named after the asset"), *SoftAssetName);
+				return false;
+			}
+		}
+		if (Reader.IsError())
+		{
+			OutReason = TEXT("can not read the soft object paths");
+			return false;
+		}
+	}
+
+	// tag values holding full object paths follow, anything else naming a renamed package is not understood
+	for (FAssetDataRef& AssetData : Header.AssetDatas)
+	{
+		for (TPair<FString, FString>& Tag : AssetData.Tags)
+		{
+			for (const TPair<int32, TPair<FString, FString>>& Pair : RenamedPackageNames)
+			{
+				const FString& OldPackageName = Pair.Value.Key;
+				const FString& NewPackageName = Pair.Value.Value;
+				Tag.Value.ReplaceInline(*(OldPackageName + TEXT(".") + FPackageName::GetShortName(OldPackageName)),
+					*(NewPackageName + TEXT(".") + FPackageName::GetShortName(NewPackageName)), ESearchCase::IgnoreCase);
+				if (Tag.Value.Contains(OldPackageName))
+				{
+					OutReason = FString::Printf(TEXT("tag %s refers to %s"), *Tag.Key, *OldPackageName);
+					return false;
+				}
+			}
+		}
+	}
+	return WriteHeader(Source, Header, OutPatched, OutReason);
+}
+
+bool FUPPackageNamePatcher::PatchFile(const FString& SourceFile, const FString& TargetFile, const FString& OldPackageName,
+	const FString& NewPackageName, FString& OutReason, TConstArrayView<TPair<FString, FString>> FolderRemaps)
+{
+	return UPPackageNamePatcher::PatchFileWith(SourceFile, TargetFile, OutReason,
+		[&](TConstArrayView<uint8> Source, TArray<uint8>& OutPatched)
+		{
+			return PatchPackage(Source, OldPackageName, NewPackageName, OutPatched, OutReason, FolderRemaps);
+		});
+}
+
+bool FUPPackageNamePatcher::CanPatchFile(const FString& File, const FString& OldPackageName, const FString& NewPackageName,
+	FString& OutReason, TConstArrayView<TPair<FString, FString>> FolderRemaps)
+{
+	using namespace UPPackageNamePatcher;
+	// mapped, only the pages of the header tables are touched
+	TUniquePtr<IMappedFileHandle> MappedFile(FPlatformFileManager::Get().GetPlatformFile().OpenMapped(*File));
+	TUniquePtr<IMappedFileRegion> MappedRegion(MappedFile ? MappedFile->MapRegion() : nullptr);
+	TArray<uint8> Loaded;
+	TConstArrayView<uint8> Source;
+	if (MappedRegion)
+	{
+		Source = TConstArrayView<uint8>(MappedRegion->GetMappedPtr(), MappedRegion->GetMappedSize());
+	}
+	else if (FFileHelper::LoadFileToArray(Loaded, *File))
+	{
+		Source = Loaded;
+	}
+	else
+	{
+		OutReason = TEXT("can not read ") + File;
+		return false;
+	}
+	FHeader Header;
+	return PrepareRename(Source, Header, OldPackageName, NewPackageName, OutReason, FolderRemaps);
+}
+
+bool FUPPackageNamePatcher::PatchReferencesFile(const FString& File, const TMap<FString, FString>& PackageRenames, FString& OutReason)
+{
+	return UPPackageNamePatcher::PatchFileWith(File, File, OutReason,
+		[&](TConstArrayView<uint8> Source, TArray<uint8>& OutPatched)
+		{
+			return PatchReferences(Source, PackageRenames, OutPatched, OutReason);
+		});
+}
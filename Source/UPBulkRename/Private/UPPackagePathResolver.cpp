@@ -0,0 +1,216 @@
+// Copyright 2024 PufStudio. All Rights Reserved.
+
+#include "UPPackagePathResolver.h"
+
+#include "AssetRegistry/AssetData.h"
+#include "AssetRegistry/IAssetRegistry.h"
+#include "Misc/PackageName.h"
+#include "Misc/Paths.h"
+
+FUPPackagePathResolver& FUPPackagePathResolver::Get()
+{
+	static FUPPackagePathResolver Instance;
+	return Instance;
+}
+
+FUPPackagePathResolver::FUPPackagePathResolver()
+{
+	MountedHandle = FPackageName::OnContentPathMounted().AddLambda([this](const FString&, const FString&)
+	{
+		Invalidate();
+	});
+	DismountedHandle = FPackageName::OnContentPathDismounted().AddLambda([this](const FString&, const FString&)
+	{
+		Invalidate();
+	});
+	// a deleted package name may come back as the other kind
+	AssetRemovedHandle = IAssetRegistry::GetChecked().OnAssetRemoved().AddLambda([this](const FAssetData& AssetData)
+	{
+		PackageExtensions.Remove(AssetData.PackageName);
+	});
+}
+
+FUPPackagePathResolver::~FUPPackagePathResolver()
+{
+	FPackageName::OnContentPathMounted().Remove(MountedHandle);
+	FPackageName::OnContentPathDismounted().Remove(DismountedHandle);
+	if (IAssetRegistry* AssetRegistry = IAssetRegistry::Get())
+	{
+		AssetRegistry->OnAssetRemoved().Remove(AssetRemovedHandle);
+	}
+}
+
+void FUPPackagePathResolver::Invalidate()
+{
+	bMountPointsBuilt = false;
+	PackageExtensions.Reset();
+}
+
+void FUPPackagePathResolver::BuildMountPoints()
+{
+	MountPoints.Reset();
+	MountPointsBySegment.Reset();
+
+	TArray<FString> Roots;
+	// read-only roots (/Script, /Memory) have nothing on disk
+	FPackageName::QueryRootContentPaths(Roots);
+	for (const FString& Root : Roots)
+	{
+		FString ContentDir;
+		if (!FPackageName::TryConvertLongPackageNameToFilename(Root, ContentDir))
+		{
+			continue;
+		}
+		ContentDir = FPaths::ConvertRelativePathToFull(ContentDir);
+		if (!ContentDir.EndsWith(TEXT("/")))
+		{
+			ContentDir += TEXT("/");
+		}
+		MountPoints.Add({Root, MoveTemp(ContentDir)});
+	}
+
+	// longest root first so nested mount points win over their parent
+	MountPoints.Sort([](const FMountPoint& A, const FMountPoint& B)
+	{
+		return A.Root.Len() > B.Root.Len();
+	});
+	for (int32 i = 0; i < MountPoints.Num(); i++)
+	{
+		FStringView Root = MountPoints[i].Root;
+		int32 SegmentEnd = INDEX_NONE;
+		Root.RightChop(1).FindChar(TEXT('/'), SegmentEnd);
+		if (SegmentEnd == INDEX_NONE)
+		{
+			continue;
+		}
+		MountPointsBySegment.FindOrAdd(FName(Root.Mid(1, SegmentEnd))).Add(i);
+	}
+	bMountPointsBuilt = true;
+}
+
+const FUPPackagePathResolver::FMountPoint* FUPPackagePathResolver::FindMountPoint(FStringView Path)
+{
+	if (!bMountPointsBuilt)
+	{
+		BuildMountPoints();
+	}
+	if (Path.Len() < 2 || Path[0] != TEXT('/'))
+	{
+		return nullptr;
+	}
+	int32 SegmentEnd = INDEX_NONE;
+	FStringView Rest = Path.RightChop(1);
+	if (!Rest.FindChar(TEXT('/'), SegmentEnd))
+	{
+		SegmentEnd = Rest.Len();
+	}
+	// FNAME_Find: an unknown first segment can never be a mount point, and nothing gets added to the name table
+	const FName Segment(Rest.Left(SegmentEnd), FNAME_Find);
+	if (Segment.IsNone())
+	{
+		return nullptr;
+	}
+	const TArray<int32, TInlineAllocator<2>>* Candidates = MountPointsBySegment.Find(Segment);
+	if (!Candidates)
+	{
+		return nullptr;
+	}
+	for (int32 Index : *Candidates)
+	{
+		const FMountPoint& MountPoint = MountPoints[Index];
+		FStringView Root = MountPoint.Root;
+		// the root itself (/Game) or anything below it (/Game/...)
+		if (Path.StartsWith(Root, ESearchCase::IgnoreCase) ||
+			Path.Equals(Root.LeftChop(1), ESearchCase::IgnoreCase))
+		{
+			return &MountPoint;
+		}
+	}
+	return nullptr;
+}
+
+const FString& FUPPackagePathResolver::FindPackageExtension(FStringView PackageName)
+{
+	const FName PackageFName(PackageName, FNAME_Find);
+	if (!PackageFName.IsNone())
+	{
+		if (const FString* const* Extension = PackageExtensions.Find(PackageFName))
+		{
+			return **Extension;
+		}
+		AssetScratch.Reset();
+		IAssetRegistry::GetChecked().GetAssetsByPackageName(PackageFName, AssetScratch, true);
+		if (AssetScratch.Num() > 0)
+		{
+			const FString& Extension = AssetScratch[0].HasAnyPackageFlags(PKG_ContainsMap) ?
+				FPackageName::GetMapPackageExtension() : FPackageName::GetAssetPackageExtension();
+			PackageExtensions.Add(PackageFName, &Extension);
+			return Extension;
+		}
+	}
+	// not known to the registry (new name, or not scanned yet), ask the disk
+	FString Filename;
+	if (FPackageName::DoesPackageExist(FString(PackageName), &Filename) &&
+		Filename.EndsWith(FPackageName::GetMapPackageExtension()))
+	{
+		return FPackageName::GetMapPackageExtension();
+	}
+	return FPackageName::GetAssetPackageExtension();
+}
+
+FStringView FUPPackagePathResolver::StripObjectName(FStringView PackageOrObjectPath)
+{
+	// /Game/A/B.B -> /Game/A/B
+	int32 LastSlash = INDEX_NONE;
+	if (PackageOrObjectPath.FindLastChar(TEXT('/'), LastSlash))
+	{
+		int32 Dot = INDEX_NONE;
+		if (PackageOrObjectPath.RightChop(LastSlash).FindChar(TEXT('.'), Dot))
+		{
+			return PackageOrObjectPath.Left(LastSlash + Dot);
+		}
+	}
+	return PackageOrObjectPath;
+}
+
+bool FUPPackagePathResolver::AppendPackageFilename(FStringView PackageOrObjectPath, FStringBuilderBase& Out)
+{
+	const FStringView PackageName = StripObjectName(PackageOrObjectPath);
+	const FMountPoint* MountPoint = FindMountPoint(PackageName);
+	if (!MountPoint)
+	{
+		return false;
+	}
+	Out << MountPoint->ContentDir << PackageName.RightChop(MountPoint->Root.Len()) << FindPackageExtension(PackageName);
+	return true;
+}
+
+bool FUPPackagePathResolver::AppendPackageFilename(FStringView PackageOrObjectPath, FStringView Extension,
+	FStringBuilderBase& Out)
+{
+	const FStringView PackageName = StripObjectName(PackageOrObjectPath);
+	const FMountPoint* MountPoint = FindMountPoint(PackageName);
+	if (!MountPoint)
+	{
+		return false;
+	}
+	Out << MountPoint->ContentDir << PackageName.RightChop(MountPoint->Root.Len()) << Extension;
+	return true;
+}
+
+bool FUPPackagePathResolver::AppendFolderPath(FStringView FolderPath, FStringBuilderBase& Out)
+{
+	const FMountPoint* MountPoint = FindMountPoint(FolderPath);
+	if (!MountPoint)
+	{
+		return false;
+	}
+	if (FolderPath.Len() < MountPoint->Root.Len())
+	{
+		// the root folder itself
+		Out << MountPoint->ContentDir;
+		return true;
+	}
+	Out << MountPoint->ContentDir << FolderPath.RightChop(MountPoint->Root.Len());
+	return true;
+}
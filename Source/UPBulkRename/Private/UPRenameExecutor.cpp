@@ -0,0 +1,1207 @@
+// Copyright 2024 PufStudio. All Rights Reserved.
+
+#include "UPRenameExecutor.h"
+
+#include "AssetToolsModule.h"
+#include "FileHelpers.h"
+#include "ISourceControlModule.h"
+#include "ObjectTools.h"
+#include "PackageTools.h"
+#include "SourceControlHelpers.h"
+#include "SourceControlOperations.h"
+#include "UPBulkRenameSettings.h"
+#include "UPBulkRenameUtility.h"
+#include "UPPackageNamePatcher.h"
+#include "UPPackagePathResolver.h"
+#include "UPPerforceConnection.h"
+#include "UPRenameJournal.h"
+#include "AssetRegistry/IAssetRegistry.h"
+#include "HAL/FileManager.h"
+#include "HAL/PlatformFileManager.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Misc/ScopedSlowTask.h"
+#include "UObject/LinkerLoad.h"
+#include "UObject/ObjectRedirector.h"
+#include "UObject/SavePackage.h"
+
+namespace UPRenameExecutor
+{
+	/** logs how long a stage took and how many items went through it, the progress dialog shows its throughput and time left */
+	struct FScopedStage
+	{
+		FScopedStage(const TCHAR* InName, int32 InNumItems)
+			: Name(InName), NumItems(InNumItems), StartTime(FPlatformTime::Seconds())
+			, SlowTask(float(FMath::Max(InNumItems, 1)), FText::FromString(InName))
+		{
+		}
+
+		~FScopedStage()
+		{
+			UE_LOG(LogUPBulkRename, Display, TEXT("Stage %-9s %6d items %9.3fs"), Name, NumItems, FPlatformTime::Seconds() - StartTime);
+		}
+
+		/** NumDone more items went through */
+		void Step(int32 NumDone = 1)
+		{
+			NumItemsDone += NumDone;
+			const double Now = FPlatformTime::Seconds();
+			// formatting for every item would cost more than renaming a small asset
+			if (Now - LastUpdateTime >= 0.1 || NumItemsDone >= NumItems)
+			{
+				LastUpdateTime = Now;
+				const double ItemsPerSecond = NumItemsDone / FMath::Max(Now - StartTime, 0.001);
+				const int32 SecondsLeft = FMath::Min(FMath::CeilToInt((NumItems - NumItemsDone) / FMath::Max(ItemsPerSecond, 0.001)), 359999);
+				Message = FText::FromString(FString::Printf(TEXT("%s  %d / %d  (%.1f/s, %d:%02d left)"),
+					Name, NumItemsDone, NumItems, ItemsPerSecond, SecondsLeft / 60, SecondsLeft % 60));
+			}
+			SlowTask.EnterProgressFrame(float(NumDone), Message);
+		}
+
+		const TCHAR* Name;
+		int32 NumItems;
+		double StartTime;
+		FScopedSlowTask SlowTask;
+		int32 NumItemsDone = 0;
+		double LastUpdateTime = 0.;
+		FText Message;
+	};
+
+	/** keeps a window of async requests open so disk reads overlap instead of stalling one by one */
+	void LoadPackages(const TArray<FName>& PackageNames, TArray<UPackage*>& OutLoaded, TSet<FName>& OutFailed, FScopedStage& Stage)
+	{
+		const int32 MaxInFlight = FMath::Max(1, GetDefault<UUPBulkRenameSettings>()->MaxInFlightPackageLoads);
+		OutLoaded.SetNumZeroed(PackageNames.Num());
+		int32 NextRequest = 0;
+		int32 NumInFlight = 0;
+		while (NextRequest < PackageNames.Num() || NumInFlight > 0)
+		{
+			while (NumInFlight < MaxInFlight && NextRequest < PackageNames.Num())
+			{
+				const int32 Index = NextRequest++;
+				NumInFlight++;
+				LoadPackageAsync(PackageNames[Index].ToString(), FLoadPackageAsyncDelegate::CreateLambda(
+					[&OutLoaded, &OutFailed, &NumInFlight, Index](const FName& PackageName, UPackage* Package, EAsyncLoadingResult::Type Result)
+					{
+						NumInFlight--;
+						if (Result == EAsyncLoadingResult::Succeeded && Package)
+						{
+							OutLoaded[Index] = Package;
+						}
+						else
+						{
+							OutFailed.Add(PackageName);
+							UE_LOG(LogUPBulkRename, Error, TEXT("Can not load %s"), *PackageName.ToString());
+						}
+					}));
+			}
+			// pump the loader until a slot frees up
+			const int32 NumInFlightBefore = NumInFlight;
+			ProcessAsyncLoadingUntilComplete([&NumInFlight, NumInFlightBefore]() { return NumInFlight < NumInFlightBefore; }, 0.5);
+			// outside the load callbacks, the progress dialog ticks slate
+			Stage.Step(NumInFlightBefore - NumInFlight);
+		}
+	}
+}
+
+FUPRenameExecutor::FUPRenameExecutor(FUPRenamePlan InPlan, bool bInApplyPerforceFix)
+	: Plan(MoveTemp(InPlan)), bApplyPerforceFix(bInApplyPerforceFix)
+{
+}
+
+bool FUPRenameExecutor::Run()
+{
+	const double StartTime = FPlatformTime::Seconds();
+	// a frame per asset, and one each for what comes before and after the chunks
+	FScopedSlowTask Progress(float(Plan.Entries.Num() + 2), FText::FromString(FString::Printf(TEXT("Renaming %d assets"), Plan.Entries.Num())));
+	Progress.MakeDialog(true);
+	Progress.EnterProgressFrame(1.f, FText::FromString(TEXT("Preparing")));
+	FUPRenameJournal Journal;
+	if (!Journal.Begin(bApplyPerforceFix))
+	{
+		UUPBulkRenameUtility::NotifyError(FText::FromString("Previous rename did not finish, restart the editor to recover it first"));
+		return false;
+	}
+
+	FileMoved.Init(false, Plan.Entries.Num());
+	FolderMoved.Init(false, Plan.Entries.Num());
+	NotRenamed.Init(false, Plan.Entries.Num());
+	PrepareFolderMoves();
+
+	// journal every step before anything moves, a folder that fails to move falls back on the per asset steps
+	for (FFolderMove& Move : FolderMoves)
+	{
+		const TPair<FString, FString>& Folder = Plan.Folders[Move.FolderIndex];
+		const FString OldDir = UUPBulkRenameUtility::MakeSysPath(Folder.Key, true);
+		const FString NewDir = UUPBulkRenameUtility::MakeSysPath(Folder.Value, true);
+		Move.MoveStep = bApplyPerforceFix ?
+			Journal.Plan(EUPJournalStep::P4Move, OldDir / TEXT("..."), NewDir / TEXT("...")) :
+			Journal.Plan(EUPJournalStep::MoveFolder, OldDir, NewDir);
+		Move.PatchStep = Journal.Plan(EUPJournalStep::PatchFolder, Folder.Key, Folder.Value);
+	}
+	for (int32 i = 0; i < Plan.Entries.Num(); i++)
+	{
+		const FUPRenameEntry& Entry = Plan.Entries[i];
+		RenameSteps.Add(Journal.Plan(EUPJournalStep::RenameAsset, Entry.OldObjectPath, Entry.NewObjectPath));
+	}
+	if (bApplyPerforceFix)
+	{
+		for (int32 i = 0; i < Plan.Entries.Num(); i++)
+		{
+			const FUPRenameEntry& Entry = Plan.Entries[i];
+			SwapSteps.Add(Journal.Plan(EUPJournalStep::MoveFile, Entry.NewFilename, Entry.OldFilename));
+		}
+		for (int32 i = 0; i < Plan.Entries.Num(); i++)
+		{
+			const FUPRenameEntry& Entry = Plan.Entries[i];
+			MoveSteps.Add(Journal.Plan(EUPJournalStep::P4Move, Entry.OldFilename, Entry.NewFilename));
+		}
+	}
+	Journal.Sync();
+
+	ClientApi P4Api;
+	FP4RecordSet Records;
+	FP4ResultInfo ResultInfo;
+	FUPPerforceConnection Connection = FUPPerforceConnection(P4Api, Records, ResultInfo);
+	if (bApplyPerforceFix)
+	{
+		if (!Connection.Init())
+		{
+			Journal.End();
+			UUPBulkRenameUtility::NotifyError(FText::FromString("Login perforce failed"));
+			return false;
+		}
+		UUPBulkRenameUtility::StopSourceControl();
+		if (!CheckoutFiles(Connection))
+		{
+			UUPBulkRenameUtility::StartSourceControl_Perforce();
+			Journal.End();
+			return false;
+		}
+	}
+	// last point where nothing has moved yet
+	if (Progress.ShouldCancel())
+	{
+		if (bApplyPerforceFix)
+			UUPBulkRenameUtility::StartSourceControl_Perforce();
+		Journal.End();
+		UE_LOG(LogUPBulkRename, Log, TEXT("Rename cancelled before anything moved"));
+		return false;
+	}
+
+	MoveFolders(Connection, Journal);
+	MoveUnreferencedFiles(Journal);
+	const TArray<TArray<int32>> Chunks = BuildChunks();
+	bool bCancelled = false;
+	for (int32 ChunkIndex = 0; ChunkIndex < Chunks.Num(); ChunkIndex++)
+	{
+		// between chunks everything done so far is saved, the rest is simply left where it is
+		if (Progress.ShouldCancel())
+		{
+			for (int32 Skipped = ChunkIndex; Skipped < Chunks.Num(); Skipped++)
+			{
+				for (const int32 i : Chunks[Skipped])
+				{
+					NotRenamed[i] = true;
+				}
+			}
+			bCancelled = true;
+			break;
+		}
+		ChunkEntries = Chunks[ChunkIndex];
+		Progress.EnterProgressFrame(float(ChunkEntries.Num()), Chunks.Num() > 1 ?
+			FText::FromString(FString::Printf(TEXT("Chunk %d / %d"), ChunkIndex + 1, Chunks.Num())) : FText::FromString(TEXT("Renaming")));
+		if (Chunks.Num() > 1)
+		{
+			UE_LOG(LogUPBulkRename, Log, TEXT("Chunk %d/%d, %d assets"), ChunkIndex + 1, Chunks.Num(), ChunkEntries.Num());
+		}
+		PreloadPackages();
+		RenameAssets();
+		SaveDirtyPackages(Journal);
+		if (Chunks.Num() > 1)
+		{
+			UnloadChunk();
+		}
+	}
+	ChunkEntries.Empty();
+	PackagesToUnload.Empty();
+	Progress.EnterProgressFrame(1.f, FText::FromString(TEXT("Finishing")));
+	if (bApplyPerforceFix)
+	{
+		SwapBack(Journal);
+		MoveInPerforce(Connection, Journal);
+		UUPBulkRenameUtility::StartSourceControl_Perforce();
+	}
+	RemoveEmptyFolders();
+	RescanMovedFiles();
+	Journal.End();
+	ValidatePatchedPackages();
+
+	const int32 NumNotRenamed = NotRenamed.FilterByPredicate([](bool bNotRenamed) { return bNotRenamed; }).Num();
+	UE_LOG(LogUPBulkRename, Display, TEXT("Renamed %d assets in %.3fs"), Plan.Entries.Num() - NumNotRenamed, FPlatformTime::Seconds() - StartTime);
+	if (bCancelled)
+	{
+		UUPBulkRenameUtility::NotifyError(FText::FromString(FString::Printf(TEXT("Rename cancelled, %d of %d assets were not renamed"), NumNotRenamed, Plan.Entries.Num())));
+		return false;
+	}
+	return true;
+}
+
+void FUPRenameExecutor::PrepareFolderMoves()
+{
+	if (Plan.Folders.IsEmpty())
+	{
+		return;
+	}
+	UPRenameExecutor::FScopedStage Stage(TEXT("FolderScan"), Plan.Folders.Num());
+	IAssetRegistry& AssetRegistry = IAssetRegistry::GetChecked();
+	TArray<FName> Referencers;
+	for (int32 FolderIndex = 0; FolderIndex < Plan.Folders.Num(); FolderIndex++)
+	{
+		Stage.Step();
+		const TPair<FString, FString>& Folder = Plan.Folders[FolderIndex];
+		const FString OldPrefix = Folder.Key + TEXT("/");
+		if (FPaths::DirectoryExists(UUPBulkRenameUtility::MakeSysPath(Folder.Value, true)))
+		{
+			continue;
+		}
+
+		// self-contained: nothing outside the folder references into it and nothing in it is loaded
+		FFolderMove Move;
+		Move.FolderIndex = FolderIndex;
+		bool bSelfContained = true;
+		for (int32 i = 0; i < Plan.Entries.Num() && bSelfContained; i++)
+		{
+			const FUPRenameEntry& Entry = Plan.Entries[i];
+			if (FolderMoved[i] || !Entry.OldObjectPath.StartsWith(OldPrefix))
+			{
+				continue;
+			}
+			const FString PackageName = Entry.GetOldPackageName();
+			if (FindPackage(nullptr, *PackageName) || !Entry.OldFilename.EndsWith(FPackageName::GetAssetPackageExtension()))
+			{
+				bSelfContained = false;
+				break;
+			}
+			Referencers.Reset();
+			AssetRegistry.GetReferencers(FName(PackageName), Referencers);
+			for (const FName Referencer : Referencers)
+			{
+				if (!Referencer.ToString().StartsWith(OldPrefix))
+				{
+					bSelfContained = false;
+					break;
+				}
+			}
+			Move.Entries.Add(i);
+		}
+		if (!bSelfContained || Move.Entries.IsEmpty())
+		{
+			continue;
+		}
+
+		// only the headers are checked before the directory moves, one refused package sends the folder down the regular path
+		const TPair<FString, FString> Remap(Folder.Key, Folder.Value);
+		for (const int32 i : Move.Entries)
+		{
+			const FUPRenameEntry& Entry = Plan.Entries[i];
+			FString Reason;
+			if (!FUPPackageNamePatcher::CanPatchFile(Entry.OldFilename, Entry.GetOldPackageName(), Entry.GetNewPackageName(), Reason,
+				MakeArrayView(&Remap, 1)))
+			{
+				UE_LOG(LogUPBulkRename, Log, TEXT("%s is renamed asset by asset, %s: %s"), *Folder.Key, *Entry.OldObjectPath, *Reason);
+				bSelfContained = false;
+				break;
+			}
+		}
+		if (!bSelfContained)
+		{
+			continue;
+		}
+		for (const int32 i : Move.Entries)
+		{
+			FolderMoved[i] = true;
+		}
+		FolderMoves.Add(MoveTemp(Move));
+	}
+}
+
+void FUPRenameExecutor::MoveFolders(FUPPerforceConnection& Connection, FUPRenameJournal& Journal)
+{
+	if (FolderMoves.IsEmpty())
+	{
+		return;
+	}
+	UPRenameExecutor::FScopedStage Stage(TEXT("FolderMove"), FolderMoves.Num());
+	// other providers see the move as delete + add, the originals stay on disk until the provider deletes them
+	const bool bSourceControlled = !bApplyPerforceFix && ISourceControlModule::Get().IsEnabled();
+	IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+	for (FFolderMove& Move : FolderMoves)
+	{
+		Stage.Step();
+		const TPair<FString, FString>& Folder = Plan.Folders[Move.FolderIndex];
+		const FString OldDir = UUPBulkRenameUtility::MakeSysPath(Folder.Key, true);
+		const FString NewDir = UUPBulkRenameUtility::MakeSysPath(Folder.Value, true);
+		TArray<FString> OldFiles;
+		TArray<FString> NewFiles;
+		for (const int32 i : Move.Entries)
+		{
+			OldFiles.Add(Plan.Entries[i].OldFilename);
+			NewFiles.Add(Plan.Entries[i].NewFilename);
+		}
+
+		// in p4 one directory wide move, the files were opened for edit with the rest
+		bool bMoved;
+		if (bApplyPerforceFix)
+		{
+			bMoved = Connection.RunCommand(TEXT("move"), { OldDir / TEXT("..."), NewDir / TEXT("...") });
+		}
+		else if (bSourceControlled)
+		{
+			bMoved = PlatformFile.CopyDirectoryTree(*NewDir, *OldDir, false);
+			if (bMoved)
+			{
+				USourceControlHelpers::MarkFilesForDelete(OldFiles, true);
+				IFileManager::Get().DeleteDirectory(*OldDir, false, true);
+			}
+			else
+			{
+				IFileManager::Get().DeleteDirectory(*NewDir, false, true);
+			}
+		}
+		else
+		{
+			bMoved = UUPBulkRenameUtility::SystemMoveDirectory(OldDir, NewDir);
+		}
+		if (!bMoved)
+		{
+			// the folder stays where it is, its assets go through their planned per asset steps
+			UUPBulkRenameUtility::NotifyError(FText::FromString(FString::Printf(TEXT("Can not move %s to %s"), *OldDir, *NewDir)));
+			for (const int32 i : Move.Entries)
+			{
+				FolderMoved[i] = false;
+			}
+			continue;
+		}
+		Journal.Done(Move.MoveStep);
+		for (const int32 i : Move.Entries)
+		{
+			Journal.Skip(RenameSteps[i]);
+			if (bApplyPerforceFix)
+			{
+				Journal.Skip(SwapSteps[i]);
+				Journal.Skip(MoveSteps[i]);
+			}
+		}
+		Journal.Sync();
+
+		// patched one file at a time where it now lives, like a resumed journal does
+		const TPair<FString, FString> Remap(Folder.Key, Folder.Value);
+		for (const int32 i : Move.Entries)
+		{
+			const FUPRenameEntry& Entry = Plan.Entries[i];
+			FString Reason;
+			if (!FUPPackageNamePatcher::PatchFile(Entry.NewFilename, Entry.NewFilename, Entry.GetOldPackageName(), Entry.GetNewPackageName(),
+				Reason, MakeArrayView(&Remap, 1)))
+			{
+				UE_LOG(LogUPBulkRename, Error, TEXT("Can not patch %s: %s"), *Entry.NewFilename, *Reason);
+				UUPBulkRenameUtility::NotifyError(FText::FromString(FString::Printf(TEXT("Can not patch %s, see the output log"), *Entry.NewFilename)));
+			}
+			FileMoved[i] = true;
+		}
+		Journal.Done(Move.PatchStep);
+		Journal.Sync();
+
+		if (bSourceControlled)
+		{
+			USourceControlHelpers::MarkFilesForAdd(NewFiles, true);
+		}
+	}
+}
+
+bool FUPRenameExecutor::CheckoutFiles(FUPPerforceConnection& Connection)
+{
+	const TArray<FString> FilesToEdit = Plan.CollectFilesToEdit();
+	UPRenameExecutor::FScopedStage Stage(TEXT("Checkout"), FilesToEdit.Num());
+	if (!Connection.RunCommand(TEXT("edit"), FilesToEdit))
+	{
+		UE_LOG(LogUPBulkRename, Error, TEXT("Checkout file failed..."))
+		UUPBulkRenameUtility::NotifyError(FText::FromString("Can not checkout files..."));
+		return false;
+	}
+	Stage.Step(FilesToEdit.Num());
+	return true;
+}
+
+void FUPRenameExecutor::MoveUnreferencedFiles(FUPRenameJournal& Journal)
+{
+	int32 NumCandidates = 0;
+	for (int32 i = 0; i < Plan.Entries.Num(); i++)
+	{
+		NumCandidates += Plan.Entries[i].bMoveFileOnly && !FolderMoved[i];
+	}
+	if (NumCandidates == 0)
+	{
+		return;
+	}
+	UPRenameExecutor::FScopedStage Stage(TEXT("FileMove"), NumCandidates);
+	// the new file is written like a save would, the perforce fix swaps it back and moves it as usual
+	TArray<FString> OldFiles;
+	TArray<FString> NewFiles;
+	for (int32 i = 0; i < Plan.Entries.Num(); i++)
+	{
+		const FUPRenameEntry& Entry = Plan.Entries[i];
+		if (!Entry.bMoveFileOnly || FolderMoved[i])
+		{
+			continue;
+		}
+		Stage.Step();
+		FString Reason;
+		if (!FUPPackageNamePatcher::PatchFile(Entry.OldFilename, Entry.NewFilename, Entry.GetOldPackageName(), Entry.GetNewPackageName(), Reason))
+		{
+			UE_LOG(LogUPBulkRename, Log, TEXT("%s needs a full rename: %s"), *Entry.OldObjectPath, *Reason);
+			continue;
+		}
+		FileMoved[i] = true;
+		OldFiles.Add(Entry.OldFilename);
+		NewFiles.Add(Entry.NewFilename);
+		// the new file is complete, a rollback has to move it back before the old one goes
+		Journal.Done(RenameSteps[i]);
+	}
+	Journal.Sync();
+	if (bApplyPerforceFix || OldFiles.IsEmpty())
+	{
+		return;
+	}
+
+	if (ISourceControlModule::Get().IsEnabled())
+	{
+		ISourceControlModule::Get().GetProvider().Execute(ISourceControlOperation::Create<FDelete>(), OldFiles);
+		USourceControlHelpers::MarkFilesForAdd(NewFiles, true);
+	}
+	// not under source control (or it could not delete them)
+	IFileManager& FileManager = IFileManager::Get();
+	for (const FString& OldFile : OldFiles)
+	{
+		if (FileManager.FileExists(*OldFile))
+		{
+			FileManager.Delete(*OldFile, false, true);
+		}
+	}
+}
+
+TArray<TArray<int32>> FUPRenameExecutor::BuildChunks() const
+{
+	TArray<int32> Pending;
+	for (int32 i = 0; i < Plan.Entries.Num(); i++)
+	{
+		if (!FileMoved[i])
+			Pending.Add(i);
+	}
+	const int64 Budget = int64(GetDefault<UUPBulkRenameSettings>()->ChunkMemoryBudgetMB) * 1024 * 1024;
+	if (Budget <= 0 || Pending.IsEmpty())
+	{
+		return { Pending };
+	}
+	UPRenameExecutor::FScopedStage Stage(TEXT("Chunk"), Pending.Num());
+
+	// union-find over packages: a renamed package and all of its referencers end up in one set
+	IAssetRegistry& AssetRegistry = IAssetRegistry::GetChecked();
+	TMap<FName, int32> NodeIndices;
+	TArray<int32> Parents;
+	TArray<int64> Sizes;
+	auto GetNode = [&](FName PackageName)
+	{
+		if (const int32* Index = NodeIndices.Find(PackageName))
+		{
+			return *Index;
+		}
+		const TOptional<FAssetPackageData> PackageData = AssetRegistry.GetAssetPackageDataCopy(PackageName);
+		Sizes.Add(PackageData ? FMath::Max<int64>(PackageData->DiskSize, 0) : 0);
+		return NodeIndices.Add(PackageName, Parents.Add(Parents.Num()));
+	};
+	auto FindRoot = [&Parents](int32 Node)
+	{
+		while (Parents[Node] != Node)
+		{
+			Parents[Node] = Parents[Parents[Node]];
+			Node = Parents[Node];
+		}
+		return Node;
+	};
+	TArray<TArray<int32>> EntryNodes;
+	EntryNodes.SetNum(Pending.Num());
+	TArray<FName> PackageReferencers;
+	for (int32 k = 0; k < Pending.Num(); k++)
+	{
+		Stage.Step();
+		const FName PackageName(Plan.Entries[Pending[k]].GetOldPackageName());
+		const int32 Node = GetNode(PackageName);
+		EntryNodes[k].Add(Node);
+		PackageReferencers.Reset();
+		AssetRegistry.GetReferencers(PackageName, PackageReferencers);
+		for (const FName Referencer : PackageReferencers)
+		{
+			const int32 ReferencerNode = GetNode(Referencer);
+			EntryNodes[k].Add(ReferencerNode);
+			Parents[FindRoot(ReferencerNode)] = FindRoot(Node);
+		}
+	}
+
+	// sets in plan order, so a folder stays together as far as the budget allows
+	TMap<int32, int32> GroupOfRoot;
+	TArray<TArray<int32>> Groups;
+	for (int32 k = 0; k < Pending.Num(); k++)
+	{
+		const int32 Root = FindRoot(EntryNodes[k][0]);
+		int32* Group = GroupOfRoot.Find(Root);
+		if (!Group)
+		{
+			Group = &GroupOfRoot.Add(Root, Groups.AddDefaulted());
+		}
+		Groups[*Group].Add(k);
+	}
+
+	TArray<TArray<int32>> Chunks;
+	Chunks.AddDefaulted();
+	TSet<int32> ChunkNodes;
+	int64 ChunkSize = 0;
+	auto StartChunk = [&]()
+	{
+		if (!Chunks.Last().IsEmpty())
+		{
+			Chunks.AddDefaulted();
+			ChunkNodes.Reset();
+			ChunkSize = 0;
+		}
+	};
+	auto GetCost = [&](int32 k)
+	{
+		int64 Cost = 0;
+		for (const int32 Node : EntryNodes[k])
+		{
+			if (!ChunkNodes.Contains(Node))
+				Cost += Sizes[Node];
+		}
+		return Cost;
+	};
+	auto AddEntry = [&](int32 k)
+	{
+		ChunkSize += GetCost(k);
+		ChunkNodes.Append(EntryNodes[k]);
+		Chunks.Last().Add(Pending[k]);
+	};
+	TSet<int32> GroupNodes;
+	for (const TArray<int32>& Group : Groups)
+	{
+		GroupNodes.Reset();
+		for (const int32 k : Group)
+		{
+			GroupNodes.Append(EntryNodes[k]);
+		}
+		int64 GroupSize = 0;
+		for (const int32 Node : GroupNodes)
+		{
+			GroupSize += Sizes[Node];
+		}
+		if (GroupSize <= Budget)
+		{
+			if (ChunkSize + GroupSize > Budget)
+				StartChunk();
+			for (const int32 k : Group)
+			{
+				AddEntry(k);
+			}
+			continue;
+		}
+		// larger than the budget on its own: split it, a shared referencer is then loaded once per chunk
+		StartChunk();
+		for (const int32 k : Group)
+		{
+			if (ChunkSize + GetCost(k) > Budget)
+				StartChunk();
+			AddEntry(k);
+		}
+	}
+	UE_LOG(LogUPBulkRename, Log, TEXT("Split %d assets into %d chunks of at most %d MB"), Pending.Num(), Chunks.Num(),
+		GetDefault<UUPBulkRenameSettings>()->ChunkMemoryBudgetMB);
+	return Chunks;
+}
+
+void FUPRenameExecutor::PreloadPackages()
+{
+	// the closure to load: every renamed package, then each referencer once
+	TArray<FName> PackageNames;
+	TSet<FName> Seen;
+	for (const int32 i : ChunkEntries)
+	{
+		const FName PackageName(Plan.Entries[i].GetOldPackageName());
+		bool bAlreadyInSet = false;
+		Seen.Add(PackageName, &bAlreadyInSet);
+		if (!bAlreadyInSet)
+			PackageNames.Add(PackageName);
+	}
+	const int32 NumRenamedPackages = PackageNames.Num();
+	IAssetRegistry& AssetRegistry = IAssetRegistry::GetChecked();
+	TMap<FName, TArray<FName>> ReferencersByPackage;
+	{
+		UPRenameExecutor::FScopedStage Stage(TEXT("Closure"), NumRenamedPackages);
+		for (int32 i = 0; i < NumRenamedPackages; i++)
+		{
+			Stage.Step();
+			TArray<FName>& PackageReferencers = ReferencersByPackage.Add(PackageNames[i]);
+			AssetRegistry.GetReferencers(PackageNames[i], PackageReferencers);
+			for (const FName Referencer : PackageReferencers)
+			{
+				bool bAlreadyInSet = false;
+				Seen.Add(Referencer, &bAlreadyInSet);
+				if (!bAlreadyInSet)
+					PackageNames.Add(Referencer);
+			}
+		}
+	}
+
+	// unloaded referencers holding plain references get their header patched after the save, they are not loaded at all
+	if (GetDefault<UUPBulkRenameSettings>()->bPatchUnloadedReferencers && PackageNames.Num() > NumRenamedPackages)
+	{
+		UPRenameExecutor::FScopedStage Stage(TEXT("PatchScan"), PackageNames.Num() - NumRenamedPackages);
+		TMap<FString, FString> ExpectedRenames;
+		for (const int32 i : ChunkEntries)
+		{
+			ExpectedRenames.Add(Plan.Entries[i].GetOldPackageName(), Plan.Entries[i].GetNewPackageName());
+		}
+		FUPPackagePathResolver& PathResolver = FUPPackagePathResolver::Get();
+		TStringBuilder<512> Filename;
+		TArray<uint8> Source;
+		TArray<uint8> Patched;
+		for (int32 i = PackageNames.Num() - 1; i >= NumRenamedPackages; i--)
+		{
+			Stage.Step();
+			const FString PackageName = PackageNames[i].ToString();
+			Filename.Reset();
+			if (FindPackage(nullptr, *PackageName) || !PathResolver.AppendPackageFilename(PackageName, Filename))
+			{
+				continue;
+			}
+			FString Reason;
+			Source.Reset();
+			if (!FFileHelper::LoadFileToArray(Source, *Filename) || !FUPPackageNamePatcher::PatchReferences(Source, ExpectedRenames, Patched, Reason))
+			{
+				UE_LOG(LogUPBulkRename, Verbose, TEXT("Load referencer %s: %s"), *PackageName, *Reason);
+				continue;
+			}
+			ReferencersToPatch.Emplace(PackageNames[i], FString(Filename.ToView()));
+			PackageNames.RemoveAt(i);
+		}
+	}
+
+	UPRenameExecutor::FScopedStage Stage(TEXT("Preload"), PackageNames.Num());
+	for (const FName PackageName : PackageNames)
+	{
+		if (!FindPackage(nullptr, *PackageName.ToString()))
+			PackagesToUnload.Add(PackageName);
+	}
+	TArray<UPackage*> LoadedPackages;
+	TSet<FName> FailedPackages;
+	UPRenameExecutor::LoadPackages(PackageNames, LoadedPackages, FailedPackages, Stage);
+
+	// the rename stage only sees assets whose package is fully resident
+	Assets.Reserve(ChunkEntries.Num());
+	for (const int32 i : ChunkEntries)
+	{
+		const FUPRenameEntry& Entry = Plan.Entries[i];
+		UObject* Asset = FindObject<UObject>(nullptr, *Entry.OldObjectPath);
+		if (Asset && !Asset->GetPackage()->IsFullyLoaded())
+		{
+			Asset->GetPackage()->FullyLoad();
+		}
+		if (!Asset)
+		{
+			UE_LOG(LogUPBulkRename, Error, TEXT("Can not load %s, it is not renamed"), *Entry.OldObjectPath);
+		}
+		Assets.Emplace(Asset);
+	}
+	for (int32 i = NumRenamedPackages; i < LoadedPackages.Num(); i++)
+	{
+		if (LoadedPackages[i])
+		{
+			Referencers.Emplace(LoadedPackages[i]);
+		}
+	}
+
+	// a referencer that never became resident is not fixed up, it still needs the redirector
+	for (const TPair<FName, TArray<FName>>& Pair : ReferencersByPackage)
+	{
+		for (const FName Referencer : Pair.Value)
+		{
+			if (FailedPackages.Contains(Referencer))
+			{
+				PackagesToKeepRedirector.Add(Pair.Key);
+				break;
+			}
+		}
+	}
+}
+
+void FUPRenameExecutor::RenameAssets()
+{
+	UPRenameExecutor::FScopedStage Stage(TEXT("Rename"), ChunkEntries.Num());
+	TSet<UPackage*> PackagesUserRefusedToFullyLoad;
+	TMap<FSoftObjectPath, FSoftObjectPath> Redirects;
+	for (int32 k = 0; k < ChunkEntries.Num(); k++)
+	{
+		Stage.Step();
+		if (!Assets[k].IsValid())
+		{
+			continue;
+		}
+		const FUPRenameEntry& Entry = Plan.Entries[ChunkEntries[k]];
+		UPackage* OldPackage = Assets[k]->GetPackage();
+		FPackageGroupName PGN;
+		PGN.PackageName = Entry.GetNewPackageName();
+		PGN.ObjectName = FPackageName::GetShortName(PGN.PackageName);
+		FText ErrorMessage;
+		// in memory only, leaves a redirector behind and marks both packages dirty
+		if (!ObjectTools::RenameSingleObject(Assets[k].Get(), PGN, PackagesUserRefusedToFullyLoad, ErrorMessage))
+		{
+			UE_LOG(LogUPBulkRename, Error, TEXT("Can not rename %s: %s"), *Entry.OldObjectPath, *ErrorMessage.ToString());
+			continue;
+		}
+		Redirects.Add(FSoftObjectPath(Entry.OldObjectPath), FSoftObjectPath(Entry.NewObjectPath));
+		PackageRenames.Add(Entry.GetOldPackageName(), Entry.GetNewPackageName());
+		DirtyPackages.Add(OldPackage);
+		DirtyPackages.Add(Assets[k]->GetPackage());
+		if (PackagesToUnload.Contains(OldPackage->GetFName()))
+		{
+			PackagesToUnload.Add(Assets[k]->GetPackage()->GetFName());
+		}
+	}
+	Assets.Empty();
+
+	// hard references already point at the moved objects, they only need to be saved again
+	for (const TStrongObjectPtr<UPackage>& Referencer : Referencers)
+	{
+		Referencer->MarkPackageDirty();
+		DirtyPackages.Add(Referencer.Get());
+	}
+	Referencers.Empty();
+
+	IAssetTools& AssetTools = FModuleManager::LoadModuleChecked<FAssetToolsModule>("AssetTools").Get();
+	AssetTools.RenameReferencingSoftObjectPaths(DirtyPackages.Array(), Redirects);
+}
+
+void FUPRenameExecutor::SaveDirtyPackages(FUPRenameJournal& Journal)
+{
+	TArray<UPackage*> Packages = DirtyPackages.Array();
+	DirtyPackages.Empty();
+	// redirectors the cleanup deletes right after are not written first, unless a referencer ends up keeping them
+	const bool bCleanupRedirectors = GetDefault<UUPBulkRenameSettings>()->bCleanupRedirectors;
+	TArray<UPackage*> RedirectorPackages;
+	if (bCleanupRedirectors)
+	{
+		TSet<FName> OldPackageNames;
+		for (const int32 i : ChunkEntries)
+		{
+			OldPackageNames.Add(FName(Plan.Entries[i].GetOldPackageName()));
+		}
+		for (int32 i = Packages.Num() - 1; i >= 0; i--)
+		{
+			const FName PackageName = Packages[i]->GetFName();
+			if (OldPackageNames.Contains(PackageName) && !PackagesToKeepRedirector.Contains(PackageName))
+			{
+				RedirectorPackages.Add(Packages[i]);
+				Packages.RemoveAtSwap(i);
+			}
+		}
+	}
+	{
+		UPRenameExecutor::FScopedStage Stage(TEXT("Save"), Packages.Num());
+		const double StartTime = FPlatformTime::Seconds();
+		// with the perforce fix source control is off and everything was opened for edit already
+		const bool bUseSourceControl = !bApplyPerforceFix && ISourceControlModule::Get().IsEnabled();
+		if (bUseSourceControl)
+		{
+			FEditorFileUtils::CheckoutPackages(Packages, nullptr, false);
+		}
+		if (int32 NumFailed = SavePackages(Packages, true, FString(), [&Stage]() { Stage.Step(); }))
+		{
+			UUPBulkRenameUtility::NotifyError(FText::FromString(FString::Printf(TEXT("%d packages could not be saved, see log"), NumFailed)));
+		}
+		if (bUseSourceControl)
+		{
+			TArray<FString> NewFiles;
+			// only renames that went through, a failed or never loaded asset has no new file to add
+			for (const int32 i : ChunkEntries)
+			{
+				const FUPRenameEntry& Entry = Plan.Entries[i];
+				if (PackageRenames.Contains(Entry.GetOldPackageName()) && FPaths::FileExists(Entry.NewFilename))
+					NewFiles.Add(Entry.NewFilename);
+			}
+			USourceControlHelpers::MarkFilesForAdd(NewFiles, true);
+		}
+		const double Seconds = FPlatformTime::Seconds() - StartTime;
+		UE_LOG(LogUPBulkRename, Display, TEXT("Saved %d packages, %.1f packages/s"), Packages.Num(), Seconds > 0. ? Packages.Num() / Seconds : 0.);
+	}
+	// the new packages are on disk, referencers can point at them
+	PatchReferencers();
+
+	// renamed objects and the journal marks below only depend on the new files
+	if (bCleanupRedirectors)
+	{
+		// a referencer the patch refused still goes through these
+		TArray<UPackage*> KeptRedirectors = RedirectorPackages.FilterByPredicate([this](const UPackage* Package)
+		{
+			return PackagesToKeepRedirector.Contains(Package->GetFName());
+		});
+		if (!KeptRedirectors.IsEmpty())
+		{
+			if (!bApplyPerforceFix && ISourceControlModule::Get().IsEnabled())
+			{
+				FEditorFileUtils::CheckoutPackages(KeptRedirectors, nullptr, false);
+			}
+			if (int32 NumFailed = SavePackages(KeptRedirectors))
+			{
+				UUPBulkRenameUtility::NotifyError(FText::FromString(FString::Printf(TEXT("%d redirectors could not be saved, see log"), NumFailed)));
+			}
+		}
+		CleanupRedirectors();
+		// one the delete left behind still has the original asset on disk
+		TArray<UPackage*> UndeletedRedirectors;
+		for (const int32 i : ChunkEntries)
+		{
+			const UObjectRedirector* Redirector = FindObject<UObjectRedirector>(nullptr, *Plan.Entries[i].OldObjectPath);
+			if (Redirector && !PackagesToKeepRedirector.Contains(Redirector->GetPackage()->GetFName()))
+			{
+				UndeletedRedirectors.Add(Redirector->GetPackage());
+			}
+		}
+		if (!UndeletedRedirectors.IsEmpty())
+		{
+			SavePackages(UndeletedRedirectors);
+		}
+	}
+
+	// a rename counts as done once the new package is on disk
+	for (const int32 i : ChunkEntries)
+	{
+		if (FPaths::FileExists(Plan.Entries[i].NewFilename))
+		{
+			Journal.Done(RenameSteps[i]);
+		}
+	}
+	Journal.Sync();
+}
+
+void FUPRenameExecutor::PatchReferencers()
+{
+	if (ReferencersToPatch.IsEmpty())
+	{
+		return;
+	}
+	UPRenameExecutor::FScopedStage Stage(TEXT("Patch"), ReferencersToPatch.Num());
+	if (!bApplyPerforceFix && ISourceControlModule::Get().IsEnabled())
+	{
+		TArray<FString> Files;
+		for (const TPair<FName, FString>& Referencer : ReferencersToPatch)
+		{
+			Files.Add(Referencer.Value);
+		}
+		USourceControlHelpers::CheckOutFiles(Files, true);
+	}
+
+	// only renames that went through, a referencer of a failed one keeps its old path
+	IAssetRegistry& AssetRegistry = IAssetRegistry::GetChecked();
+	TArray<FName> Dependencies;
+	for (const TPair<FName, FString>& Referencer : ReferencersToPatch)
+	{
+		Stage.Step();
+		FString Reason;
+		if (FUPPackageNamePatcher::PatchReferencesFile(Referencer.Value, PackageRenames, Reason))
+		{
+			PatchedReferencers.Add(Referencer);
+			continue;
+		}
+		UE_LOG(LogUPBulkRename, Warning, TEXT("Can not patch referencer %s: %s"), *Referencer.Key.ToString(), *Reason);
+		// still on the old paths, the redirectors it goes through stay
+		Dependencies.Reset();
+		AssetRegistry.GetDependencies(Referencer.Key, Dependencies);
+		for (const FName Dependency : Dependencies)
+		{
+			if (PackageRenames.Contains(Dependency.ToString()))
+			{
+				PackagesToKeepRedirector.Add(Dependency);
+			}
+		}
+	}
+	ReferencersToPatch.Empty();
+}
+
+void FUPRenameExecutor::UnloadChunk()
+{
+	TArray<UPackage*> Packages;
+	for (const FName PackageName : PackagesToUnload)
+	{
+		if (UPackage* Package = FindPackage(nullptr, *PackageName.ToString()))
+			Packages.Add(Package);
+	}
+	PackagesToUnload.Empty();
+	UPRenameExecutor::FScopedStage Stage(TEXT("Unload"), Packages.Num());
+	// packages the user had open stay, dirty ones (a failed save) too
+	FText ErrorMessage;
+	if (!Packages.IsEmpty() && !UPackageTools::UnloadPackages(Packages, ErrorMessage))
+	{
+		UE_LOG(LogUPBulkRename, Warning, TEXT("Can not unload every package of the chunk: %s"), *ErrorMessage.ToString());
+	}
+	CollectGarbage(GARBAGE_COLLECTION_KEEPFLAGS);
+	Stage.Step(Packages.Num());
+}
+
+void FUPRenameExecutor::CleanupRedirectors()
+{
+	// every referencer was resident and saved with the new paths, so the redirectors are dead weight
+	TArray<UObject*> Redirectors;
+	for (const int32 i : ChunkEntries)
+	{
+		const FUPRenameEntry& Entry = Plan.Entries[i];
+		if (PackagesToKeepRedirector.Contains(FName(Entry.GetOldPackageName())))
+		{
+			UE_LOG(LogUPBulkRename, Warning, TEXT("Keep redirector %s, some referencers could not be loaded"), *Entry.OldObjectPath);
+			continue;
+		}
+		if (UObjectRedirector* Redirector = FindObject<UObjectRedirector>(nullptr, *Entry.OldObjectPath))
+		{
+			Redirectors.Add(Redirector);
+		}
+	}
+	if (Redirectors.IsEmpty())
+	{
+		return;
+	}
+	UPRenameExecutor::FScopedStage Stage(TEXT("Redirect"), Redirectors.Num());
+	// one call: the files go away in a single source control delete (or straight from disk when it is off,
+	// with the perforce fix the swap back then puts the real asset at the old file)
+	const int32 NumDeleted = ObjectTools::DeleteObjectsUnchecked(Redirectors);
+	Stage.Step(Redirectors.Num());
+	UE_LOG(LogUPBulkRename, Log, TEXT("Deleted %d of %d redirectors"), NumDeleted, Redirectors.Num());
+}
+
+int32 FUPRenameExecutor::SavePackages(const TArray<UPackage*>& Packages, bool bAsync, const FString& OutputDir,
+	const TFunction<void()>& OnPackageSaved)
+{
+	FSavePackageArgs SaveArgs;
+	SaveArgs.TopLevelFlags = RF_Standalone;
+	SaveArgs.SaveFlags = SAVE_NoError | (bAsync ? SAVE_Async : SAVE_None);
+	if (!OutputDir.IsEmpty())
+	{
+		// same as autosave: write a copy and leave the package as it is
+		SaveArgs.SaveFlags |= SAVE_FromAutosave | SAVE_KeepDirty;
+	}
+
+	int32 NumFailed = 0;
+	for (UPackage* Package : Packages)
+	{
+		const FString& Extension = Package->ContainsMap() ?
+			FPackageName::GetMapPackageExtension() : FPackageName::GetAssetPackageExtension();
+		FString Filename;
+		if (!OutputDir.IsEmpty())
+		{
+			Filename = OutputDir / Package->GetName() + Extension;
+		}
+		else if (!FPackageName::TryConvertLongPackageNameToFilename(Package->GetName(), Filename, Extension))
+		{
+			UE_LOG(LogUPBulkRename, Error, TEXT("No file for package %s"), *Package->GetName());
+			NumFailed++;
+			continue;
+		}
+		if (!UPackage::SavePackage(Package, Package->FindAssetInPackage(), *Filename, SaveArgs))
+		{
+			UE_LOG(LogUPBulkRename, Error, TEXT("Can not save %s"), *Filename);
+			NumFailed++;
+		}
+		if (OnPackageSaved)
+		{
+			OnPackageSaved();
+		}
+	}
+	UPackage::WaitForAsyncFileWrites();
+	return NumFailed;
+}
+
+void FUPRenameExecutor::SwapBack(FUPRenameJournal& Journal)
+{
+	UPRenameExecutor::FScopedStage Stage(TEXT("SwapBack"), Plan.Entries.Num());
+	TArray<TPair<FString, FString>> Moves;
+	TArray<int32> MoveEntries;
+	Moves.Reserve(Plan.Entries.Num());
+	for (int32 i = 0; i < Plan.Entries.Num(); i++)
+	{
+		if (FolderMoved[i] || NotRenamed[i])
+			continue;
+		Moves.Emplace(Plan.Entries[i].NewFilename, Plan.Entries[i].OldFilename);
+		MoveEntries.Add(i);
+	}
+	TArray<bool> Moved;
+	if (int32 NumFailed = UUPBulkRenameUtility::SystemRenameBatch(Moves, nullptr, &Moved))
+	{
+		UUPBulkRenameUtility::NotifyError(FText::FromString(FString::Printf(TEXT("%d files could not be swapped back, see log"), NumFailed)));
+	}
+	Stage.Step(Plan.Entries.Num());
+	for (int32 i = 0; i < Moved.Num(); i++)
+	{
+		if (Moved[i])
+			Journal.Done(SwapSteps[MoveEntries[i]]);
+	}
+	Journal.Sync();
+}
+
+void FUPRenameExecutor::MoveInPerforce(FUPPerforceConnection& Connection, FUPRenameJournal& Journal)
+{
+	UPRenameExecutor::FScopedStage Stage(TEXT("P4Move"), Plan.Entries.Num());
+	for (int32 i = 0; i < Plan.Entries.Num(); i++)
+	{
+		Stage.Step();
+		if (FolderMoved[i] || NotRenamed[i])
+			continue;
+		const FUPRenameEntry& Entry = Plan.Entries[i];
+		if (!Connection.RunCommand(TEXT("move"), { Entry.OldFilename, Entry.NewFilename }))
+		{
+			FString Msg = FString::Printf(TEXT("Can not move file from %s to %s"), *Entry.OldFilename, *Entry.NewFilename);
+			UE_LOG(LogUPBulkRename, Error, TEXT("%s"), *Msg);
+			UUPBulkRenameUtility::NotifyError(FText::FromString(Msg));
+			continue;
+		}
+		Journal.Done(MoveSteps[i]);
+	}
+}
+
+void FUPRenameExecutor::RescanMovedFiles()
+{
+	TArray<FString> Files;
+	for (int32 i = 0; i < Plan.Entries.Num(); i++)
+	{
+		if (FileMoved[i])
+		{
+			Files.Add(Plan.Entries[i].OldFilename);
+			Files.Add(Plan.Entries[i].NewFilename);
+		}
+	}
+	for (const TPair<FName, FString>& Referencer : PatchedReferencers)
+	{
+		Files.Add(Referencer.Value);
+	}
+	if (!Files.IsEmpty())
+	{
+		// picks up the new packages and drops the ones whose file is gone, patched referencers get their new dependencies
+		IAssetRegistry::GetChecked().ScanModifiedAssetFiles(Files);
+	}
+}
+
+void FUPRenameExecutor::RemoveEmptyFolders()
+{
+	if (Plan.Folders.IsEmpty())
+	{
+		return;
+	}
+	UPRenameExecutor::FScopedStage Stage(TEXT("Cleanup"), Plan.Folders.Num());
+	IAssetRegistry& AssetRegistry = IAssetRegistry::GetChecked();
+	IFileManager& FileManager = IFileManager::Get();
+	for (const TPair<FString, FString>& Folder : Plan.Folders)
+	{
+		Stage.Step();
+		const FString OldDir = UUPBulkRenameUtility::MakeSysPath(Folder.Key, true);
+		TArray<FString> Dirs;
+		FileManager.IterateDirectoryRecursively(*OldDir, [&Dirs](const TCHAR* Path, bool bIsDirectory)
+		{
+			if (bIsDirectory)
+				Dirs.Add(Path);
+			return true;
+		});
+		// deepest first, anything still holding a file is kept
+		Dirs.Sort([](const FString& A, const FString& B) { return A.Len() > B.Len(); });
+		Dirs.Add(OldDir);
+		for (const FString& Dir : Dirs)
+		{
+			FileManager.DeleteDirectory(*Dir, false, false);
+		}
+		if (!FileManager.DirectoryExists(*OldDir))
+		{
+			AssetRegistry.RemovePath(Folder.Key);
+		}
+	}
+}
+
+void FUPRenameExecutor::ValidatePatchedPackages()
+{
+	if (!GetDefault<UUPBulkRenameSettings>()->bValidatePatchedPackages)
+	{
+		return;
+	}
+	// every package whose header was rewritten instead of saved by the engine
+	TArray<FName> PackageNames;
+	for (int32 i = 0; i < Plan.Entries.Num(); i++)
+	{
+		if (FileMoved[i])
+			PackageNames.Emplace(Plan.Entries[i].GetNewPackageName());
+	}
+	for (const TPair<FName, FString>& Referencer : PatchedReferencers)
+	{
+		PackageNames.Add(Referencer.Key);
+	}
+	if (PackageNames.IsEmpty())
+	{
+		return;
+	}
+	UPRenameExecutor::FScopedStage Stage(TEXT("Validate"), PackageNames.Num());
+	// only what validation brought in is unloaded again
+	TSet<FName> ResidentPackages;
+	for (const FName PackageName : PackageNames)
+	{
+		if (FindPackage(nullptr, *PackageName.ToString()))
+			ResidentPackages.Add(PackageName);
+	}
+	TArray<UPackage*> LoadedPackages;
+	TSet<FName> FailedPackages;
+	UPRenameExecutor::LoadPackages(PackageNames, LoadedPackages, FailedPackages, Stage);
+	int32 NumInvalid = FailedPackages.Num();
+	for (UPackage* Package : LoadedPackages)
+	{
+		if (!Package)
+		{
+			continue;
+		}
+		// an import that did not resolve is a path the patch got wrong
+		int32 NumMissingImports = 0;
+		if (FLinkerLoad* Linker = Package->GetLinker())
+		{
+			for (const FObjectImport& Import : Linker->ImportMap)
+			{
+				if (!Import.XObject && !Import.bImportOptional)
+				{
+					UE_LOG(LogUPBulkRename, Error, TEXT("%s: import %s did not resolve"), *Package->GetName(), *Import.ObjectName.ToString());
+					NumMissingImports++;
+				}
+			}
+		}
+		if (NumMissingImports > 0 || !Package->FindAssetInPackage())
+		{
+			NumInvalid++;
+		}
+	}
+	if (NumInvalid > 0)
+	{
+		UUPBulkRenameUtility::NotifyError(FText::FromString(FString::Printf(TEXT("%d patched packages did not load cleanly, see log"), NumInvalid)));
+	}
+
+	TArray<UPackage*> Packages;
+	for (UPackage* Package : LoadedPackages)
+	{
+		if (Package && !ResidentPackages.Contains(Package->GetFName()))
+			Packages.Add(Package);
+	}
+	FText ErrorMessage;
+	if (!Packages.IsEmpty() && !UPackageTools::UnloadPackages(Packages, ErrorMessage))
+	{
+		UE_LOG(LogUPBulkRename, Warning, TEXT("Can not unload every validated package: %s"), *ErrorMessage.ToString());
+	}
+	CollectGarbage(GARBAGE_COLLECTION_KEEPFLAGS);
+}
@@ -0,0 +1,384 @@
+// Copyright 2024 PufStudio. All Rights Reserved.
+
+#include "UPRenameJournal.h"
+
+#include "EditorAssetLibrary.h"
+#include "UPBulkRenameUtility.h"
+#include "UPPackageNamePatcher.h"
+#include "UPPerforceConnection.h"
+#include "HAL/FileManager.h"
+#include "HAL/PlatformFileManager.h"
+#include "Misc/FileHelper.h"
+#include "Misc/MessageDialog.h"
+#include "Misc/PackageName.h"
+#include "Misc/Paths.h"
+
+namespace UPRenameJournal
+{
+	/** done marks are synced to disk every this many steps */
+	constexpr int32 SyncInterval = 64;
+
+	const TCHAR* StepNames[] = { TEXT("RenameAsset"), TEXT("RenameFolder"), TEXT("MoveFile"), TEXT("P4Move"),
+		TEXT("MoveFolder"), TEXT("PatchFolder") };
+
+	bool ParseStep(const FString& Name, EUPJournalStep::Type& OutStep)
+	{
+		for (int32 i = 0; i < UE_ARRAY_COUNT(StepNames); i++)
+		{
+			if (Name == StepNames[i])
+			{
+				OutStep = static_cast<EUPJournalStep::Type>(i);
+				return true;
+			}
+		}
+		return false;
+	}
+
+	/**
+	 * Give every package file found under the moved folder the ToFolder paths instead of the FromFolder ones.
+	 * Packages already patched no longer carry the FromFolder name and are refused, so this can run again.
+	 */
+	void PatchFolder(const FString& FromFolder, const FString& ToFolder, const FString& MovedFolder)
+	{
+		const FString Dir = UUPBulkRenameUtility::MakeSysPath(MovedFolder, true);
+		TArray<FString> Files;
+		IFileManager::Get().FindFilesRecursive(Files, *Dir, *(TEXT("*") + FPackageName::GetAssetPackageExtension()), true, false);
+		IFileManager::Get().FindFilesRecursive(Files, *Dir, *(TEXT("*") + FPackageName::GetMapPackageExtension()), true, false, false);
+		const TPair<FString, FString> Remap(FromFolder, ToFolder);
+		for (const FString& File : Files)
+		{
+			const FString RelativePackage = FPaths::ChangeExtension(File.RightChop(Dir.Len()), TEXT(""));
+			FString Reason;
+			FUPPackageNamePatcher::PatchFile(File, File, FromFolder + RelativePackage, ToFolder + RelativePackage, Reason,
+				MakeArrayView(&Remap, 1));
+		}
+	}
+
+	/** whether a p4 move source is on disk, a file or a whole directory (Dir/...) */
+	bool P4PathExists(const FString& Path)
+	{
+		return Path.EndsWith(TEXT("/...")) ? FPaths::DirectoryExists(Path.LeftChop(4)) : FPaths::FileExists(Path);
+	}
+
+	/** run p4 move for a list of pairs on one connection */
+	void RunP4Moves(const TArray<TPair<FString, FString>>& Moves)
+	{
+		if (Moves.IsEmpty())
+		{
+			return;
+		}
+		ClientApi P4Api;
+		FP4RecordSet Records;
+		FP4ResultInfo ResultInfo;
+		FUPPerforceConnection Connection = FUPPerforceConnection(P4Api, Records, ResultInfo);
+		if (!Connection.Init())
+		{
+			UUPBulkRenameUtility::NotifyError(FText::FromString("Login perforce failed, p4 moves were not recovered"));
+			return;
+		}
+		for (const TPair<FString, FString>& Move : Moves)
+		{
+			if (!Connection.RunCommand(TEXT("move"), { Move.Key, Move.Value }))
+			{
+				UE_LOG(LogUPBulkRename, Error, TEXT("Can not move file from %s to %s"), *Move.Key, *Move.Value);
+			}
+		}
+	}
+}
+
+FUPRenameJournal::~FUPRenameJournal()
+{
+	if (Handle)
+	{
+		Handle->Flush(true);
+	}
+}
+
+FString FUPRenameJournal::GetJournalPath()
+{
+	return FPaths::ProjectSavedDir() / TEXT("UPBulkRename") / TEXT("RenameJournal.txt");
+}
+
+bool FUPRenameJournal::HasUnfinishedBatch()
+{
+	return FPaths::FileExists(GetJournalPath());
+}
+
+bool FUPRenameJournal::Begin(bool bPerforceFix)
+{
+	if (HasUnfinishedBatch())
+	{
+		UE_LOG(LogUPBulkRename, Error, TEXT("Unfinished rename journal at %s, recover it before renaming again"), *GetJournalPath());
+		return false;
+	}
+	IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+	PlatformFile.CreateDirectoryTree(*FPaths::GetPath(GetJournalPath()));
+	Handle.Reset(PlatformFile.OpenWrite(*GetJournalPath(), true));
+	if (!Handle)
+	{
+		UE_LOG(LogUPBulkRename, Error, TEXT("Can not open rename journal %s"), *GetJournalPath());
+		return false;
+	}
+	NumSteps = 0;
+	DoneSinceSync = 0;
+	Append(FString::Printf(TEXT("BEGIN\t%d"), bPerforceFix ? 1 : 0));
+	return true;
+}
+
+int32 FUPRenameJournal::Plan(EUPJournalStep::Type Step, const FString& From, const FString& To)
+{
+	Append(FString::Printf(TEXT("PLAN\t%s\t%s\t%s"), UPRenameJournal::StepNames[Step], *From, *To));
+	return NumSteps++;
+}
+
+void FUPRenameJournal::Done(int32 StepIndex)
+{
+	if (StepIndex == INDEX_NONE)
+	{
+		return;
+	}
+	Append(FString::Printf(TEXT("DONE\t%d"), StepIndex));
+	if (++DoneSinceSync >= UPRenameJournal::SyncInterval)
+	{
+		Sync();
+	}
+}
+
+void FUPRenameJournal::Skip(int32 StepIndex)
+{
+	if (StepIndex == INDEX_NONE)
+	{
+		return;
+	}
+	Append(FString::Printf(TEXT("SKIP\t%d"), StepIndex));
+}
+
+void FUPRenameJournal::Sync()
+{
+	if (Handle)
+	{
+		Handle->Flush(true);
+	}
+	DoneSinceSync = 0;
+}
+
+void FUPRenameJournal::End()
+{
+	if (!Handle)
+	{
+		return;
+	}
+	Handle.Reset();
+	FPlatformFileManager::Get().GetPlatformFile().DeleteFile(*GetJournalPath());
+}
+
+void FUPRenameJournal::Append(const FString& Line)
+{
+	if (!Handle)
+	{
+		return;
+	}
+	FTCHARToUTF8 Utf8(*(Line + TEXT("\n")));
+	Handle->Write(reinterpret_cast<const uint8*>(Utf8.Get()), Utf8.Length());
+}
+
+bool FUPRenameJournal::ReadJournal(TArray<FStep>& OutSteps, bool& bOutPerforceFix)
+{
+	TArray<FString> Lines;
+	if (!FFileHelper::LoadFileToStringArray(Lines, *GetJournalPath()))
+	{
+		return false;
+	}
+	bOutPerforceFix = false;
+	for (const FString& Line : Lines)
+	{
+		TArray<FString> Fields;
+		Line.ParseIntoArray(Fields, TEXT("\t"), false);
+		if (Fields.IsEmpty())
+		{
+			continue;
+		}
+		if (Fields[0] == TEXT("BEGIN") && Fields.Num() == 2)
+		{
+			bOutPerforceFix = Fields[1] == TEXT("1");
+		}
+		else if (Fields[0] == TEXT("PLAN") && Fields.Num() == 4)
+		{
+			FStep& Step = OutSteps.AddDefaulted_GetRef();
+			if (!UPRenameJournal::ParseStep(Fields[1], Step.Type))
+			{
+				return false;
+			}
+			Step.From = Fields[2];
+			Step.To = Fields[3];
+		}
+		else if (Fields[0] == TEXT("DONE") && Fields.Num() == 2)
+		{
+			const int32 Index = FCString::Atoi(*Fields[1]);
+			if (OutSteps.IsValidIndex(Index))
+			{
+				OutSteps[Index].bDone = true;
+			}
+		}
+		else if (Fields[0] == TEXT("SKIP") && Fields.Num() == 2)
+		{
+			const int32 Index = FCString::Atoi(*Fields[1]);
+			if (OutSteps.IsValidIndex(Index))
+			{
+				OutSteps[Index].bSkipped = true;
+			}
+		}
+		// a torn last line from the crash is simply ignored
+	}
+	return true;
+}
+
+void FUPRenameJournal::RecoverUnfinishedBatch()
+{
+	TArray<FStep> Steps;
+	bool bPerforceFix = false;
+	if (!ReadJournal(Steps, bPerforceFix))
+	{
+		UUPBulkRenameUtility::NotifyError(FText::FromString("Can not read unfinished rename journal " + GetJournalPath()));
+		return;
+	}
+	const int32 NumDone = Steps.FilterByPredicate([](const FStep& Step) { return Step.bDone || Step.bSkipped; }).Num();
+	const FText Message = FText::FromString(FString::Printf(TEXT(
+		"UP Bulk Rename did not finish last time (%d of %d steps done).\n\n"
+		"Yes: resume from the last completed step\n"
+		"No: roll back the completed steps\n"
+		"Cancel: decide later (renaming stays blocked)"), NumDone, Steps.Num()));
+	switch (FMessageDialog::Open(EAppMsgType::YesNoCancel, Message))
+	{
+	case EAppReturnType::Yes:
+		Resume(Steps, bPerforceFix);
+		break;
+	case EAppReturnType::No:
+		Rollback(Steps, bPerforceFix);
+		break;
+	default:
+		return;
+	}
+	if (bPerforceFix)
+	{
+		UUPBulkRenameUtility::StartSourceControl_Perforce();
+	}
+	FPlatformFileManager::Get().GetPlatformFile().DeleteFile(*GetJournalPath());
+}
+
+void FUPRenameJournal::Resume(const TArray<FStep>& Steps, bool bPerforceFix)
+{
+	if (bPerforceFix)
+	{
+		UUPBulkRenameUtility::StopSourceControl();
+	}
+	// steps were planned in execution order, consecutive file moves go as one batch
+	TArray<TPair<FString, FString>> FileMoves;
+	TArray<TPair<FString, FString>> P4Moves;
+	for (const FStep& Step : Steps)
+	{
+		if (Step.bDone || Step.bSkipped)
+		{
+			continue;
+		}
+		if (Step.Type != EUPJournalStep::MoveFile && !FileMoves.IsEmpty())
+		{
+			UUPBulkRenameUtility::SystemRenameBatch(FileMoves);
+			FileMoves.Reset();
+		}
+		if (Step.Type == EUPJournalStep::PatchFolder && !P4Moves.IsEmpty())
+		{
+			// the folder's files have to be in place before they are patched
+			UPRenameJournal::RunP4Moves(P4Moves);
+			P4Moves.Reset();
+		}
+		switch (Step.Type)
+		{
+		case EUPJournalStep::RenameAsset:
+			if (UEditorAssetLibrary::DoesAssetExist(Step.From) && !UEditorAssetLibrary::DoesAssetExist(Step.To))
+				UEditorAssetLibrary::RenameAsset(Step.From, Step.To);
+			break;
+		case EUPJournalStep::RenameFolder:
+			if (UEditorAssetLibrary::DoesDirectoryHaveAssets(Step.From))
+				UEditorAssetLibrary::RenameDirectory(Step.From, Step.To);
+			break;
+		case EUPJournalStep::MoveFile:
+			if (FPaths::FileExists(Step.From))
+				FileMoves.Emplace(Step.From, Step.To);
+			break;
+		case EUPJournalStep::P4Move:
+			if (UPRenameJournal::P4PathExists(Step.From))
+				P4Moves.Emplace(Step.From, Step.To);
+			break;
+		case EUPJournalStep::MoveFolder:
+			if (FPaths::DirectoryExists(Step.From) && !FPaths::DirectoryExists(Step.To))
+				UUPBulkRenameUtility::SystemMoveDirectory(Step.From, Step.To);
+			break;
+		case EUPJournalStep::PatchFolder:
+			UPRenameJournal::PatchFolder(Step.From, Step.To, Step.To);
+			break;
+		}
+	}
+	UUPBulkRenameUtility::SystemRenameBatch(FileMoves);
+	UPRenameJournal::RunP4Moves(P4Moves);
+	UUPBulkRenameUtility::NotifySuccess(FText::FromString("Unfinished UP Bulk Rename resumed"));
+}
+
+void FUPRenameJournal::Rollback(const TArray<FStep>& Steps, bool bPerforceFix)
+{
+	if (bPerforceFix)
+	{
+		UUPBulkRenameUtility::StopSourceControl();
+	}
+	// undo the completed steps newest first, each one swapped
+	TArray<TPair<FString, FString>> FileMoves;
+	TArray<TPair<FString, FString>> P4Moves;
+	for (int32 i = Steps.Num() - 1; i >= 0; i--)
+	{
+		const FStep& Step = Steps[i];
+		// a folder patch may have stopped half way, it is undone either way (patched files only)
+		if (Step.bSkipped || (!Step.bDone && Step.Type != EUPJournalStep::PatchFolder))
+		{
+			continue;
+		}
+		if (Step.Type != EUPJournalStep::MoveFile && !FileMoves.IsEmpty())
+		{
+			UUPBulkRenameUtility::SystemRenameBatch(FileMoves);
+			FileMoves.Reset();
+		}
+		if (Step.Type != EUPJournalStep::P4Move && !P4Moves.IsEmpty())
+		{
+			UPRenameJournal::RunP4Moves(P4Moves);
+			P4Moves.Reset();
+		}
+		switch (Step.Type)
+		{
+		case EUPJournalStep::RenameAsset:
+			if (UEditorAssetLibrary::DoesAssetExist(Step.To))
+				UEditorAssetLibrary::RenameAsset(Step.To, Step.From);
+			break;
+		case EUPJournalStep::RenameFolder:
+			if (UEditorAssetLibrary::DoesDirectoryHaveAssets(Step.To))
+				UEditorAssetLibrary::RenameDirectory(Step.To, Step.From);
+			break;
+		case EUPJournalStep::MoveFile:
+			if (FPaths::FileExists(Step.To))
+				FileMoves.Emplace(Step.To, Step.From);
+			break;
+		case EUPJournalStep::P4Move:
+			if (UPRenameJournal::P4PathExists(Step.To))
+				P4Moves.Emplace(Step.To, Step.From);
+			break;
+		case EUPJournalStep::MoveFolder:
+			if (FPaths::DirectoryExists(Step.To) && !FPaths::DirectoryExists(Step.From))
+				UUPBulkRenameUtility::SystemMoveDirectory(Step.To, Step.From);
+			break;
+		case EUPJournalStep::PatchFolder:
+			UPRenameJournal::PatchFolder(Step.To, Step.From, Step.To);
+			break;
+		}
+	}
+	UUPBulkRenameUtility::SystemRenameBatch(FileMoves);
+	UPRenameJournal::RunP4Moves(P4Moves);
+	UUPBulkRenameUtility::NotifySuccess(FText::FromString("Unfinished UP Bulk Rename rolled back, files opened in perforce stay opened"));
+}
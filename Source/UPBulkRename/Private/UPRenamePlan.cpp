@@ -0,0 +1,121 @@
+// Copyright 2024 PufStudio. All Rights Reserved.
+
+#include "UPRenamePlan.h"
+
+#include "EditorAssetLibrary.h"
+#include "UPPackagePathResolver.h"
+#include "AssetRegistry/IAssetRegistry.h"
+#include "Misc/PackageName.h"
+#include "Misc/Paths.h"
+
+FString FUPRenameEntry::GetOldPackageName() const
+{
+	FString Left;
+	return OldObjectPath.Split(TEXT("."), &Left, nullptr, ESearchCase::CaseSensitive, ESearchDir::FromEnd) ?
+		Left : OldObjectPath;
+}
+
+FString FUPRenameEntry::GetNewPackageName() const
+{
+	FString Left;
+	return NewObjectPath.Split(TEXT("."), &Left, nullptr, ESearchCase::CaseSensitive, ESearchDir::FromEnd) ?
+		Left : NewObjectPath;
+}
+
+FUPRenamePlan FUPRenamePlan::MakeForAssets(const TArray<TPair<FString, FString>>& AssetPaths)
+{
+	FUPRenamePlan Plan;
+	Plan.Entries.Reserve(AssetPaths.Num());
+	for (const TPair<FString, FString>& Pair : AssetPaths)
+	{
+		Plan.AddEntry(Pair.Key, CopyTemp(Pair.Value));
+	}
+	return Plan;
+}
+
+FUPRenamePlan FUPRenamePlan::MakeForFolders(const TArray<TPair<FString, FString>>& FolderPaths)
+{
+	FUPRenamePlan Plan;
+	for (const TPair<FString, FString>& Folder : FolderPaths)
+	{
+		FString OldFolder = Folder.Key;
+		FString NewFolder = Folder.Value;
+		FPaths::RemoveDuplicateSlashes(OldFolder);
+		FPaths::RemoveDuplicateSlashes(NewFolder);
+		OldFolder.RemoveFromEnd(TEXT("/"));
+		NewFolder.RemoveFromEnd(TEXT("/"));
+		Plan.Folders.Emplace(OldFolder, NewFolder);
+
+		// the folder rewrite rule: /Old/Sub/A.A -> /New/Sub/A.A
+		for (const FString& OldObjectPath : UEditorAssetLibrary::ListAssets(OldFolder))
+		{
+			if (!OldObjectPath.StartsWith(OldFolder + TEXT("/")))
+			{
+				continue;
+			}
+			Plan.AddEntry(OldObjectPath, NewFolder + OldObjectPath.RightChop(OldFolder.Len()));
+		}
+	}
+	return Plan;
+}
+
+TArray<FString> FUPRenamePlan::CollectFilesToEdit() const
+{
+	IAssetRegistry& AssetRegistry = IAssetRegistry::GetChecked();
+	FUPPackagePathResolver& PathResolver = FUPPackagePathResolver::Get();
+	TSet<FName> Packages;
+	TArray<FName> Referencers;
+	TArray<FAssetIdentifier> AssetDependencies;
+	TArray<FString> FilesToEdit;
+	TStringBuilder<512> SysPath;
+	for (const FUPRenameEntry& Entry : Entries)
+	{
+		FilesToEdit.Add(Entry.OldFilename);
+		Packages.Add(FName(Entry.GetOldPackageName()));
+	}
+	for (const FUPRenameEntry& Entry : Entries)
+	{
+		const FName PkgName(Entry.GetOldPackageName());
+		Referencers.Reset();
+		AssetRegistry.GetReferencers(PkgName, Referencers);
+		AssetDependencies.Reset();
+		AssetRegistry.GetDependencies(FAssetIdentifier(PkgName), AssetDependencies);
+		for (const FAssetIdentifier& AssetDependency : AssetDependencies)
+		{
+			Referencers.Add(AssetDependency.PackageName);
+		}
+		for (const FName Referencer : Referencers)
+		{
+			bool bAlreadyInSet = false;
+			Packages.Add(Referencer, &bAlreadyInSet);
+			SysPath.Reset();
+			if (!bAlreadyInSet && PathResolver.AppendPackageFilename(WriteToString<256>(Referencer), SysPath))
+			{
+				FilesToEdit.Emplace(SysPath.ToView());
+			}
+		}
+	}
+	return FilesToEdit;
+}
+
+void FUPRenamePlan::AddEntry(const FString& OldObjectPath, FString&& NewObjectPath)
+{
+	FUPPackagePathResolver& PathResolver = FUPPackagePathResolver::Get();
+	FUPRenameEntry& Entry = Entries.AddDefaulted_GetRef();
+	Entry.OldObjectPath = OldObjectPath;
+	Entry.NewObjectPath = MoveTemp(NewObjectPath);
+
+	TStringBuilder<512> SysPath;
+	PathResolver.AppendPackageFilename(Entry.OldObjectPath, SysPath);
+	Entry.OldFilename = SysPath.ToString();
+
+	// a renamed map stays a map
+	SysPath.Reset();
+	PathResolver.AppendPackageFilename(Entry.NewObjectPath, FPaths::GetExtension(Entry.OldFilename, true), SysPath);
+	Entry.NewFilename = SysPath.ToString();
+
+	TArray<FName> Referencers;
+	IAssetRegistry::GetChecked().GetReferencers(FName(Entry.GetOldPackageName()), Referencers);
+	Entry.bMoveFileOnly = Referencers.IsEmpty() && !FindPackage(nullptr, *Entry.GetOldPackageName())
+		&& Entry.OldFilename.EndsWith(FPackageName::GetAssetPackageExtension());
+}
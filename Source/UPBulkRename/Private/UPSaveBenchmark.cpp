@@ -0,0 +1,73 @@
+// Copyright 2024 PufStudio. All Rights Reserved.
+
+#include "UPPerforceConnection.h"
+#include "UPRenameExecutor.h"
+#include "AssetRegistry/IAssetRegistry.h"
+#include "HAL/FileManager.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/Paths.h"
+
+namespace UPSaveBenchmark
+{
+	/**
+	 * UPBulkRename.BenchmarkSave /Game/Path [MaxPackages]
+	 * Saves copies of the packages under a path into Saved/UPBulkRename/SaveBenchmark, in growing batches,
+	 * once with blocking writes and once with async writes, and logs the time against the package count.
+	 * The project content is never written.
+	 */
+	void Run(const TArray<FString>& Args)
+	{
+		if (Args.IsEmpty())
+		{
+			UE_LOG(LogUPBulkRename, Warning, TEXT("Usage: UPBulkRename.BenchmarkSave /Game/Path [MaxPackages]"));
+			return;
+		}
+		const int32 MaxPackages = Args.Num() > 1 ? FCString::Atoi(*Args[1]) : 1000;
+
+		TArray<FAssetData> AssetDatas;
+		IAssetRegistry::GetChecked().GetAssetsByPath(FName(Args[0]), AssetDatas, true);
+		TSet<FName> PackageNames;
+		for (const FAssetData& AssetData : AssetDatas)
+		{
+			if (PackageNames.Num() >= MaxPackages)
+				break;
+			PackageNames.Add(AssetData.PackageName);
+		}
+		TArray<UPackage*> Packages;
+		for (const FName PackageName : PackageNames)
+		{
+			if (UPackage* Package = LoadPackage(nullptr, *PackageName.ToString(), LOAD_None))
+			{
+				Packages.Add(Package);
+			}
+		}
+		if (Packages.IsEmpty())
+		{
+			UE_LOG(LogUPBulkRename, Warning, TEXT("No packages under %s"), *Args[0]);
+			return;
+		}
+
+		const FString OutputDir = FPaths::ProjectSavedDir() / TEXT("UPBulkRename") / TEXT("SaveBenchmark");
+		UE_LOG(LogUPBulkRename, Display, TEXT("%8s %10s %10s %12s"), TEXT("Packages"), TEXT("Sync s"), TEXT("Async s"), TEXT("Async pkg/s"));
+		for (int32 Count = 1; ; Count = FMath::Min(Count * 10, Packages.Num()))
+		{
+			TArray<UPackage*> Batch(Packages.GetData(), Count);
+			double StartTime = FPlatformTime::Seconds();
+			FUPRenameExecutor::SavePackages(Batch, false, OutputDir / TEXT("Sync"));
+			const double SyncSeconds = FPlatformTime::Seconds() - StartTime;
+			StartTime = FPlatformTime::Seconds();
+			FUPRenameExecutor::SavePackages(Batch, true, OutputDir / TEXT("Async"));
+			const double AsyncSeconds = FPlatformTime::Seconds() - StartTime;
+			UE_LOG(LogUPBulkRename, Display, TEXT("%8d %10.3f %10.3f %12.1f"), Count, SyncSeconds, AsyncSeconds,
+				AsyncSeconds > 0. ? Count / AsyncSeconds : 0.);
+			if (Count >= Packages.Num())
+				break;
+		}
+		IFileManager::Get().DeleteDirectory(*OutputDir, false, true);
+	}
+
+	FAutoConsoleCommand BenchmarkSaveCommand(
+		TEXT("UPBulkRename.BenchmarkSave"),
+		TEXT("Time the rename save stage against package count: UPBulkRename.BenchmarkSave /Game/Path [MaxPackages]"),
+		FConsoleCommandWithArgsDelegate::CreateStatic(&Run));
+}
@@ -2,6 +2,10 @@
 
 #pragma once
 #include "CoreMinimal.h"
+#include "AssetRegistry/IAssetRegistry.h"
+#include "Containers/Ticker.h"
+#include "SUPPreviewText.h"
+#include "UPAssetQuery.h"
 #include "Widgets/SCompoundWidget.h"
 
 
@@ -12,24 +16,68 @@ namespace ENewNameValidStatus
 		Valid,
 		NoChange,
 		InValid,
-		Duplicated
+		Duplicated,
+		// actor label used by another actor of the level or row of the batch, a warning only
+		LabelInUse
 	};
 }
 
+/** Status categories the row filter works on, a warning counts with the status it warns about */
+namespace ERowFilter
+{
+	enum Type : uint8
+	{
+		Valid = 1 << 0,
+		NoChange = 1 << 1,
+		InValid = 1 << 2,
+		Duplicated = 1 << 3
+	};
+}
+
+/**
+ * Labels in use in a level: the actors outside the batch plus the pending new label of every row.
+ * Rows move their own count as their new label changes, so a duplicate check is a single lookup.
+ */
+class FUPActorLabelIndex
+{
+public:
+	void Add(const FString& Label) { Counts.FindOrAdd(Label)++; }
+	void Remove(const FString& Label);
+	bool IsDuplicated(const FString& Label) const { return Counts.FindRef(Label) > 1; }
+	void Reserve(int32 Num) { Counts.Reserve(Num); }
+private:
+	TMap<FString, int32> Counts;
+};
+
 class FRenameActionData : public TSharedFromThis<FRenameActionData>
 {
 public:
+	/** the label is captured once here, rows are refreshed through RefreshActorLabel on label change */
 	FRenameActionData(AActor* InActor)
-		:TargetActor(InActor)
+		: OriginalFullPath(InActor->GetActorLabel()), TempFinalPath(OriginalFullPath), TargetActor(InActor),
+		ActorGuid(InActor->GetActorGuid())
 	{
-		TempFinalPath = InActor->GetActorLabel();
+		UpdateDisplayText();
 	}
 	FRenameActionData(const FString& Original, bool* InIsFolder, bool* InShouldShowPath)
 		: OriginalFullPath(Original), TempFinalPath(Original), IsFolder(InIsFolder), ShouldShowPath(InShouldShowPath)
+	{
+		ResetFinalFullPath();
+		UpdateDisplayText();
+	}
+	/** a folder group node of the tree, not a row to rename */
+	explicit FRenameActionData(const FString& InFolder)
+		: OriginalFullPath(InFolder), bIsGroup(true)
 	{}
+	/** an actor listed from its world partition descriptor, it may not be loaded */
+	FRenameActionData(const FGuid& InActorGuid, const FString& InLabel)
+		: OriginalFullPath(InLabel), TempFinalPath(InLabel), ActorGuid(InActorGuid)
+	{
+		UpdateDisplayText();
+	}
 	FString OriginalFullPath;
 	FString TempFinalPath;
-	FString RenamingPath;
+	FUPPreview Preview;
 	bool* IsFolder = nullptr;
 	bool* ShouldShowPath = nullptr;
 	bool IsNewPathDuplicated = false;
@@ -38,11 +86,48 @@ public:
 	void ResetFinalFullPath();
 	ENewNameValidStatus::Type GetNewNameStatus() const;
 	const FSlateBrush* GetStatusIcon() const;
+
+	/**
+	 * Row view model: display strings are built once, not per widget generation or paint.
+	 * Old name is the asset name, the folder or the actor label, old path is the package path.
+	 */
+	void UpdateDisplayText();
+	const FText& GetOldText() const;
+	/** rebuilt only when the new name actually changed */
+	const FText& GetNewText() const;
+	FText OldNameText;
+	FText OldPathText;
+	mutable FString NewTextSource;
+	mutable FText NewText;
 	
 	AActor* TargetActor = nullptr;
-};
+	FGuid ActorGuid;
+	bool IsActor() const { return TargetActor || ActorGuid.IsValid(); }
+	/** cached original label of an actor row */
+	const FString& GetActorLabel() const { return OriginalFullPath; }
+	/** the actor was relabeled outside the dialog, an untouched new name follows it */
+	void RefreshActorLabel(const FString& NewLabel);
+	/** move this row's count in the label index to its current new label */
+	void SyncLabelIndex();
+	TSharedPtr<FUPActorLabelIndex> LabelIndex;
+	FString IndexedLabel;
 
-DECLARE_MULTICAST_DELEGATE(FOnEditRenameOperations)
+	/** ERowFilter category of the current status, it only depends on this row */
+	uint8 GetFilterCategory() const;
+	// position in the sorted rows and category the row is indexed under
+	int32 SortRank = 0;
+	uint8 FilterCategory = 0;
+
+	// folder grouping: the content folder of an asset row and the group it is listed under
+	FString Folder;
+	TWeakPtr<FRenameActionData> Group;
+	// a group node: its visible rows, handed to the tree only once it is expanded, and their count per ERowFilter category
+	bool bIsGroup = false;
+	TArray<TSharedPtr<FRenameActionData>> GroupRows;
+	int32 GroupCounts[4] = {};
+	FText GetGroupText() const;
+	const FSlateBrush* GetGroupStatusIcon() const;
+};
 
 class SRenameRow : public SMultiColumnTableRow<TSharedPtr<FRenameActionData>>
 {
@@ -54,9 +139,7 @@ public:
 	virtual TSharedRef<SWidget> GenerateWidgetForColumn(const FName& InColumnName) override;
 private:
 	TSharedPtr<FRenameActionData> MyData;
-	TSharedPtr<class SWidgetSwitcher> NewPathSwitcher;
 	class SUPDialog* ParentDialog = nullptr;
-	TArray<TSharedRef<class ITextDecorator>> MyDecorator;
 };
 
 class UPBULKRENAME_API SUPDialog : public SWindow
@@ -68,20 +151,31 @@ public:
 
 	SLATE_END_ARGS()
 
+	virtual ~SUPDialog() override;
+
 	/** Constructs this widget with InArgs */
 	void Construct(const FArguments& InArgs, const TArray<FString>& InSelectedPaths, const bool InIsFolder);
 	void Construct(const FArguments& InArgs, const TArray<AActor*>& InSelectedActors);
+	void Construct(const FArguments& InArgs, const FUPAssetQuery& InQuery);
+	void Construct(const FArguments& InArgs, UWorld* InWorld);
 	void CreateDialogContent();
 
 	static void Open(const TArray<FString>& InSelectedPaths, bool InIsFolder = false);
 	static void Open(const TArray<AActor*> InSelectedActors);
+	/** Open on the assets matching a registry query, rows stream in over a few frames */
+	static void Open(const FUPAssetQuery& InQuery);
+	/** Open on every actor of a partitioned world, listed from its actor descriptors so nothing has to be loaded */
+	static void Open(UWorld* InWorld);
 	
 	// UI params
 	bool IsActor = false;
 	bool IsFolder = false;
 	bool ShouldEditPath = false;
-	FOnEditRenameOperations StartEdit;
-	FOnEditRenameOperations EndEdit;
+	/** rows show the operation preview instead of the editable new name while operations are being edited */
+	bool IsEditingOperations() const { return bStartOperationEdit; }
+	/** a row's new name was edited by hand, it is re-indexed but stays where it is in the list */
+	void UpdateRowIndex(const TSharedPtr<FRenameActionData>& Data);
+	bool IsGroupingByFolder() const { return bGroupByFolder; }
 private:
 	// UI events
 	void ResetOperations();
@@ -93,9 +187,66 @@ private:
 	void AssetsRename();
 	bool CanExecuteRename() const;
 	void UpdateOperationEditPreview();
+	FText MakeDialogTitle() const;
+
+	// asset registry still scanning when the dialog opens
+	void WatchAssetRegistryScan(const TArray<FString>& InSelectedPaths);
+	void OnAssetRegistryProgress(const IAssetRegistry::FFileLoadProgressUpdateData& ProgressData);
+	void OnAssetRegistryFilesLoaded();
+	bool bWaitingForAssetRegistry = false;
+	FText AssetRegistryProgress;
+	FDelegateHandle FileLoadProgressHandle;
+	FDelegateHandle FilesLoadedHandle;
+
+	// registry query results streamed into the list
+	void RunAssetQuery();
+	bool TickQueryRows(float DeltaTime);
+	TOptional<FUPAssetQuery> PendingQuery;
+	TArray<FString> PendingQueryRows;
+	int32 NextQueryRow = 0;
+	bool bStreamingRows = false;
+	FTSTicker::FDelegateHandle QueryTickerHandle;
+
+	// actors listed from world partition descriptors
+	TWeakObjectPtr<UWorld> PartitionedWorld;
+
+	// actor rows by guid, to refresh their cached label, and the label index of their level
+	void IndexActorRows();
+	void BuildLabelIndices();
+	void OnActorLabelChanged(AActor* Actor);
+	TMap<FGuid, TSharedPtr<FRenameActionData>> ActorRows;
+	// actors of the indexed levels without a row, with their label index and the label counted there
+	TMap<FGuid, TPair<TSharedPtr<FUPActorLabelIndex>, FString>> OutsideActorLabels;
+	FDelegateHandle ActorLabelChangedHandle;
 
 	TSharedPtr<STreeView<TSharedPtr<FRenameActionData>>> ListWidget;
 	TArray<TSharedPtr<FRenameActionData>> RenameData;
+
+	// filter and sort index: every row in sort order with its rank, and the rows of each status category.
+	// Rows are re-indexed as they change, the list only rebuilds its visible items from the index.
+	void AddRowsToIndex(int32 FirstRow);
+	void UpdateRowIndices();
+	void SortRows();
+	void RebuildVisibleRows();
+	bool PassesTextFilter(const FRenameActionData& Data) const;
+	void OnSortColumn(EColumnSortPriority::Type SortPriority, const FName& ColumnName, EColumnSortMode::Type NewSortMode);
+	TSharedRef<SWidget> MakeStatusFilterToggle(const FString& Label, ERowFilter::Type Category);
+	TArray<TSharedPtr<FRenameActionData>> SortedRows;
+	TMap<uint8, TSet<TSharedPtr<FRenameActionData>>> RowsByCategory;
+	TArray<TSharedPtr<FRenameActionData>> VisibleRows;
+	FString FilterText;
+	// ERowFilter flags, none set shows every status
+	uint8 StatusFilter = 0;
+	FName SortColumn;
+	EColumnSortMode::Type SortMode = EColumnSortMode::None;
+	bool bSortDirty = false;
+
+	// asset rows grouped by folder, the tree holds the group nodes and only expanded ones list their rows
+	void GroupVisibleRows();
+	bool bGroupByFolder = false;
+	TMap<FString, TSharedPtr<FRenameActionData>> GroupNodes;
+	// stands in for the rows of a collapsed group so it shows an expander
+	TSharedPtr<FRenameActionData> CollapsedGroupChild;
 	
 	// UI params
 	bool bApplyPerforceFix = false;
@@ -0,0 +1,58 @@
+// Copyright 2024 PufStudio. All Rights Reserved.
+
+#pragma once
+#include "CoreMinimal.h"
+#include "Widgets/SLeafWidget.h"
+
+namespace EPreviewSpan
+{
+	enum Type : uint8
+	{
+		Kept,
+		Removed,
+		Added
+	};
+}
+
+/** A run of preview text drawn in one style */
+struct FUPPreviewSpan
+{
+	int32 Start = 0;
+	int32 Len = 0;
+	EPreviewSpan::Type Kind = EPreviewSpan::Kept;
+};
+
+/** Operation preview of a new name: the plain text and the spans over it, no markup to escape or parse */
+struct FUPPreview
+{
+	FString Text;
+	TArray<FUPPreviewSpan, TInlineAllocator<4>> Spans;
+
+	void Reset();
+	/** append, merged into the last span when it is of the same kind */
+	void Append(FStringView Chars, EPreviewSpan::Type Kind);
+	void Append(TCHAR Char, EPreviewSpan::Type Kind) { Append(FStringView(&Char, 1), Kind); }
+};
+
+/**
+ * Draws a FUPPreview span by span: kept text in the default style, added text in "a", removed text in "r" and struck out.
+ * The preview is read at paint time, its owner has to outlive the widget.
+ */
+class SUPPreviewText : public SLeafWidget
+{
+public:
+	SLATE_BEGIN_ARGS(SUPPreviewText) {}
+		SLATE_ARGUMENT(const FUPPreview*, Preview)
+	SLATE_END_ARGS()
+
+	void Construct(const FArguments& InArgs);
+
+	virtual int32 OnPaint(const FPaintArgs& Args, const FGeometry& AllottedGeometry, const FSlateRect& MyCullingRect,
+		FSlateWindowElementList& OutDrawElements, int32 LayerId, const FWidgetStyle& InWidgetStyle, bool bParentEnabled) const override;
+
+protected:
+	virtual FVector2D ComputeDesiredSize(float LayoutScaleMultiplier) const override;
+
+private:
+	const FUPPreview* Preview = nullptr;
+};
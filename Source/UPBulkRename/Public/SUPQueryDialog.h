@@ -0,0 +1,44 @@
+// Copyright 2024 PufStudio. All Rights Reserved.
+
+#pragma once
+#include "CoreMinimal.h"
+#include "Widgets/SWindow.h"
+
+/**
+ * Small window to describe an asset registry query, opens SUPDialog with the matches.
+ * Opened on a world it queries the level's actors instead, see FUPActorQuery.
+ */
+class UPBULKRENAME_API SUPQueryDialog : public SWindow
+{
+public:
+	SLATE_BEGIN_ARGS(SUPQueryDialog)
+		{
+		}
+
+	SLATE_END_ARGS()
+
+	void Construct(const FArguments& InArgs, const TArray<FString>& InRootPaths);
+
+	void Construct(const FArguments& InArgs, UWorld* InWorld);
+
+	static void Open(const TArray<FString>& InRootPaths);
+	static void Open(UWorld* InWorld);
+
+private:
+	void CreateDialogContent();
+	void RunQuery();
+	void RunActorQuery(UWorld* InWorld);
+	TSharedRef<SWidget> MakeField(const FString& Label, const FString& Hint, FText& Value);
+	TSharedRef<SWidget> MakeNameField(const FString& Label, const FString& Hint);
+
+	// query params, as typed
+	FText RootPaths;
+	FText ClassNames;
+	FText NamePattern;
+	FText Tags;
+	FText DataLayers;
+	bool bNameIsRegex = false;
+
+	// set when querying actors
+	TWeakObjectPtr<UWorld> World;
+};
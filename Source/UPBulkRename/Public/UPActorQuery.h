@@ -0,0 +1,31 @@
+// Copyright 2024 PufStudio. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * Select actors of a level from a query instead of a viewport selection.
+ * Actors are gathered on the game thread, the read-only filters then run in parallel on worker threads.
+ * Values of one filter are alternatives, filters combine: class AND label AND folder AND data layer AND tag.
+ */
+struct UPBULKRENAME_API FUPActorQuery
+{
+	/** actor classes, subclasses included */
+	TArray<const UClass*> Classes;
+	/** actor label filter, wildcard (SM_*) or regex, empty matches everything */
+	FString LabelPattern;
+	bool bLabelIsRegex = false;
+	/** outliner folders, sub folders included (Props/Rocks) */
+	TArray<FString> Folders;
+	/** data layer asset names */
+	TArray<FName> DataLayers;
+	/** actor tags */
+	TArray<FName> Tags;
+
+	/** Run the query over the actors of every level in World, matches are appended to OutActors */
+	void Evaluate(UWorld* World, TArray<AActor*>& OutActors) const;
+
+	/** "StaticMeshActor" or "/Script/Engine.StaticMeshActor" -> loaded actor class, null if unknown */
+	static const UClass* ParseClass(const FString& ClassName);
+};
@@ -0,0 +1,25 @@
+// Copyright 2024 PufStudio. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * Relabels a batch of actors under a single undo transaction, with nothing selected while it runs.
+ * Each label change still notifies the outliner and property listeners, only the transaction and selection are batched.
+ */
+class UPBULKRENAME_API FUPActorRelabeler
+{
+public:
+	/** Actor -> new label, actors already carrying their label are skipped. @return number of actors relabeled */
+	static int32 Relabel(const TArray<TPair<AActor*, FString>>& Labels);
+
+	/**
+	 * Relabel actors of a partitioned world by guid, loaded or not.
+	 * Loaded actors go through Relabel. Unloaded ones are pinned by reference in batches under a null loading context,
+	 * which loads the actor alone: no cell is loaded and nothing is registered in the editor world.
+	 * Each batch is relabeled, its external packages saved, then released and garbage collected. Those saves are final, they are not undoable.
+	 * @return number of actors relabeled
+	 */
+	static int32 RelabelPartitioned(UWorld* World, const TArray<TPair<FGuid, FString>>& Labels);
+};
@@ -0,0 +1,32 @@
+// Copyright 2024 PufStudio. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "AssetRegistry/ARFilter.h"
+
+/**
+ * Select assets straight from the asset registry instead of a content browser selection.
+ * Paths, classes and tags go through the registry's indexed FARFilter lookups,
+ * only the name pattern is checked per asset.
+ */
+struct UPBULKRENAME_API FUPAssetQuery
+{
+	/** content folders, searched recursively (/Game/Props) */
+	TArray<FName> PackagePaths;
+	/** asset classes, subclasses included */
+	TArray<FTopLevelAssetPath> ClassPaths;
+	/** asset name filter, wildcard (SM_*) or regex, empty matches everything */
+	FString NamePattern;
+	bool bNameIsRegex = false;
+	/** registry tag filters, an unset value matches any value of the tag */
+	TMultiMap<FName, TOptional<FString>> TagsAndValues;
+
+	FARFilter MakeFilter() const;
+
+	/** Run the query, object paths of the matches are appended to OutObjectPaths */
+	void Evaluate(TArray<FString>& OutObjectPaths) const;
+
+	/** "StaticMesh" or "/Script/Engine.StaticMesh" -> class path, empty if unknown */
+	static FTopLevelAssetPath ParseClassPath(const FString& ClassName);
+};
@@ -22,5 +22,10 @@ private:
 	TSharedRef<FExtender> LevelEditorMenuExtender(const TSharedRef<FUICommandList> UICommandList,
 		const TArray<AActor*> SelectedActors);
 
+	void RegisterMenus();
+	void OnPostEngineInit();
+	FDelegateHandle PostEngineInitHandle;
+	FDelegateHandle FilesLoadedHandle;
+
 };
 
@@ -24,4 +24,31 @@ public:
 	FString Password;
 	UPROPERTY(EditAnywhere, Config, Category="Perforce|Connection", meta=(EditCondition="bAllowPerforceFix", EditConditionHides))
 	FString Workspace;
+
+	/** Delete the redirectors left by a rename once every referencer has been fixed up and saved */
+	UPROPERTY(EditAnywhere, Config, Category="Rename")
+	bool bCleanupRedirectors = false;
+
+	/** How many packages the rename preload stage keeps loading at once */
+	UPROPERTY(EditAnywhere, Config, Category="Performance", meta=(ClampMin=1, UIMin=1, UIMax=512))
+	int32 MaxInFlightPackageLoads = 64;
+
+	/**
+	 * Split large renames into chunks whose packages, estimated from their size on disk, stay under this budget.
+	 * Each chunk is loaded, renamed, saved and unloaded before the next one starts. 0 runs the batch in one go.
+	 */
+	UPROPERTY(EditAnywhere, Config, Category="Performance", meta=(ClampMin=0, UIMin=0, UIMax=65536, Units="Megabytes"))
+	int32 ChunkMemoryBudgetMB = 4096;
+
+	/** How many unloaded world partition actors are loaded, relabeled and saved together before they are released */
+	UPROPERTY(EditAnywhere, Config, Category="Performance", meta=(ClampMin=1, UIMin=1, UIMax=4096))
+	int32 UnloadedActorBatchSize = 256;
+
+	/** Fix up referencers that are not loaded by rewriting their package header instead of loading and saving them, formats it does not understand are still loaded */
+	UPROPERTY(EditAnywhere, Config, Category="Performance")
+	bool bPatchUnloadedReferencers = false;
+
+	/** Load every package whose header a rename rewrote once the batch is done, report the ones that do not load cleanly and unload them again */
+	UPROPERTY(EditAnywhere, Config, Category="Performance")
+	bool bValidatePatchedPackages = true;
 };
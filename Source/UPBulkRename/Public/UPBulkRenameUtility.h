@@ -28,7 +28,21 @@ public:
 	UFUNCTION(BlueprintCallable, Category="PerforceRename")
 	static void SystemRename(const FString& OldName, const FString& NewName);
 
-	static FString MakeSysPath(const FString& Path, bool IsFolder = false, bool IsPkgName = false);
+	/**
+	 * Move a whole batch of files (from -> to), an existing target is replaced.
+	 * Each distinct target directory is created once and independent moves run on a few worker tasks.
+	 * Nothing throws: failures are logged and returned one message per file.
+	 * @param OutMoved optional, per move whether it succeeded
+	 * @return number of files that failed to move
+	 */
+	static int32 SystemRenameBatch(const TArray<TPair<FString, FString>>& Moves, TArray<FString>* OutErrors = nullptr,
+		TArray<bool>* OutMoved = nullptr);
+
+	/** Move a whole directory in one file system operation, the target must not exist yet */
+	static bool SystemMoveDirectory(const FString& FromDir, const FString& ToDir);
+
+	/** Package name / object path / content folder -> absolute file path, see FUPPackagePathResolver */
+	static FString MakeSysPath(const FString& Path, bool IsFolder = false);
 	
 	UFUNCTION(BlueprintCallable, Category="PerforceRename|Notifications")
 	static void NotifySuccess(FText Message, FString HyperLinkURL = "", FText HyperLinkText = FText::GetEmpty());
@@ -0,0 +1,55 @@
+// Copyright 2024 PufStudio. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * Rename a package file without loading it.
+ * The package header is rewritten in place of a load/rename/save cycle:
+ * - the summary gets the new package name
+ * - the new asset name is appended to the name table and the top level exports point at it
+ * - object names in the thumbnail table and the asset registry data follow
+ * - with folder remaps, every path into a moved folder (imports, soft paths, tag values) follows it
+ * - every absolute offset behind a rewritten section is shifted, export data is copied as is
+ * Anything it can not rewrite safely (cooked or unversioned packages, maps, legacy bulk data,
+ * self references by path that are not remapped, names derived from a changed asset name) is refused,
+ * the caller falls back to the regular rename.
+ * The same rewrite fixes up a referencer of renamed packages without loading it, see PatchReferences.
+ */
+class UPBULKRENAME_API FUPPackageNamePatcher
+{
+public:
+	/**
+	 * Patch a package held in memory.
+	 * @param OutReason why the package was refused, when it returns false
+	 * @param FolderRemaps old -> new content folder, for packages moved together with everything they reference
+	 */
+	static bool PatchPackage(TConstArrayView<uint8> Source, const FString& OldPackageName, const FString& NewPackageName,
+		TArray<uint8>& OutPatched, FString& OutReason, TConstArrayView<TPair<FString, FString>> FolderRemaps = {});
+
+	/**
+	 * Read SourceFile, patch it and write the result to TargetFile (the same file patches in place).
+	 * The target is written next to itself first and swapped in, the source is left alone.
+	 */
+	static bool PatchFile(const FString& SourceFile, const FString& TargetFile, const FString& OldPackageName,
+		const FString& NewPackageName, FString& OutReason, TConstArrayView<TPair<FString, FString>> FolderRemaps = {});
+
+	/**
+	 * Whether PatchFile would accept the file, only its header is read and nothing is written.
+	 * Lets a caller decide before anything moves without holding patched copies in memory.
+	 */
+	static bool CanPatchFile(const FString& File, const FString& OldPackageName, const FString& NewPackageName,
+		FString& OutReason, TConstArrayView<TPair<FString, FString>> FolderRemaps = {});
+
+	/**
+	 * Point the imports and soft object paths of a package at renamed packages, the package itself keeps its name.
+	 * Refused when the package does not reference any of them, or references a class or sub object named after a renamed asset.
+	 * @param PackageRenames old -> new long package name
+	 */
+	static bool PatchReferences(TConstArrayView<uint8> Source, const TMap<FString, FString>& PackageRenames,
+		TArray<uint8>& OutPatched, FString& OutReason);
+
+	/** Patch the references of a package file in place */
+	static bool PatchReferencesFile(const FString& File, const TMap<FString, FString>& PackageRenames, FString& OutReason);
+};
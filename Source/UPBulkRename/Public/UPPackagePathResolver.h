@@ -0,0 +1,68 @@
+// Copyright 2024 PufStudio. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Misc/StringBuilder.h"
+
+struct FAssetData;
+
+/**
+ * Turn package names, object paths and content folders into absolute file system paths.
+ * Mount points are read once from the registered content roots and cached per root, they are
+ * rebuilt only when a content path is mounted or dismounted.
+ * Game thread only, the package extension is looked up in the asset registry once per package.
+ */
+class UPBULKRENAME_API FUPPackagePathResolver
+{
+public:
+	static FUPPackagePathResolver& Get();
+
+	/**
+	 * Append the package file of a long package name or object path (/Game/A/B or /Game/A/B.B).
+	 * The extension comes from the package actually on disk (.umap for maps, .uasset otherwise).
+	 * @return false if the path is not under any mounted content root
+	 */
+	bool AppendPackageFilename(FStringView PackageOrObjectPath, FStringBuilderBase& Out);
+
+	/** Same, with a known extension (.uasset / .umap), for packages that do not exist yet */
+	bool AppendPackageFilename(FStringView PackageOrObjectPath, FStringView Extension, FStringBuilderBase& Out);
+
+	/** Append the directory of a content folder (/Game/A -> <Project>/Content/A) */
+	bool AppendFolderPath(FStringView FolderPath, FStringBuilderBase& Out);
+
+	/** Forget the cached mount points and extensions, they will be rebuilt on the next lookup */
+	void Invalidate();
+
+	~FUPPackagePathResolver();
+
+private:
+	FUPPackagePathResolver();
+
+	struct FMountPoint
+	{
+		/** long package root with both slashes, e.g. /Game/ */
+		FString Root;
+		/** absolute content dir with trailing slash */
+		FString ContentDir;
+	};
+
+	void BuildMountPoints();
+	const FMountPoint* FindMountPoint(FStringView Path);
+	static FStringView StripObjectName(FStringView PackageOrObjectPath);
+	const FString& FindPackageExtension(FStringView PackageName);
+
+	TArray<FMountPoint> MountPoints;
+	/** first path segment (Game, Engine, MyPlugin) -> mount points under it, longest root first */
+	TMap<FName, TArray<int32, TInlineAllocator<2>>> MountPointsBySegment;
+	bool bMountPointsBuilt = false;
+
+	/** reused by every extension lookup so the registry query does not allocate per call */
+	TArray<FAssetData> AssetScratch;
+	/** package name -> extension of the packages the registry knows, new names are not cached */
+	TMap<FName, const FString*> PackageExtensions;
+
+	FDelegateHandle MountedHandle;
+	FDelegateHandle DismountedHandle;
+	FDelegateHandle AssetRemovedHandle;
+};
@@ -8,7 +8,7 @@ THIRD_PARTY_INCLUDES_START
 #include <p4/i18napi.h>
 THIRD_PARTY_INCLUDES_END
 
-DECLARE_LOG_CATEGORY_EXTERN(LogUPBulkRename, Warning, All)
+DECLARE_LOG_CATEGORY_EXTERN(LogUPBulkRename, Display, All)
 /**
  * simplified perforce required structs and class def
  * copy unreal implementation and remove parts where 100% useless in this case.
@@ -0,0 +1,98 @@
+// Copyright 2024 PufStudio. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UPRenamePlan.h"
+#include "UObject/StrongObjectPtr.h"
+
+class FUPPerforceConnection;
+class FUPRenameJournal;
+
+/**
+ * Runs a whole rename plan as a few batched stages instead of one engine rename per row:
+ * checkout -> folder move -> file move -> preload -> rename -> save (-> redirector cleanup) -> swap back -> p4 move -> cleanup.
+ * Unreferenced, unloaded assets skip the engine entirely: their file is patched and moved, see FUPPackageNamePatcher.
+ * So do folders nothing outside references into: the directory moves in one go and its packages are patched.
+ * Optionally unloaded referencers are patched the same way instead of being loaded and saved again.
+ * The rename stage calls ObjectTools::RenameSingleObject per asset rather than IAssetTools::RenameAssets,
+ * which would save, check out and fix up redirectors per call; it only renames in memory and marks packages dirty.
+ * Renamed assets, their redirectors and every fixed-up referencer are then saved once, together, with async file writes.
+ * Large batches run preload -> save in reference-closed chunks under a memory budget, unloading between chunks.
+ * Each stage logs its timing and reports progress, the batch can be cancelled between chunks.
+ */
+class UPBULKRENAME_API FUPRenameExecutor
+{
+public:
+	FUPRenameExecutor(FUPRenamePlan InPlan, bool bInApplyPerforceFix);
+
+	/** Run every stage, errors are notified as they happen. @return false if the batch did not run to the end */
+	bool Run();
+
+	/**
+	 * Save packages in one go, file writes are queued and waited for once at the end.
+	 * @param OutputDir optional, write copies under this folder instead (the packages stay dirty)
+	 * @param OnPackageSaved optional, called after each package is queued for writing
+	 * @return number of packages that failed to save
+	 */
+	static int32 SavePackages(const TArray<UPackage*>& Packages, bool bAsync = true, const FString& OutputDir = FString(),
+		const TFunction<void()>& OnPackageSaved = nullptr);
+
+private:
+	void PrepareFolderMoves();
+	bool CheckoutFiles(FUPPerforceConnection& Connection);
+	void MoveFolders(FUPPerforceConnection& Connection, FUPRenameJournal& Journal);
+	void MoveUnreferencedFiles(FUPRenameJournal& Journal);
+	TArray<TArray<int32>> BuildChunks() const;
+	void PreloadPackages();
+	void RenameAssets();
+	void SaveDirtyPackages(FUPRenameJournal& Journal);
+	void PatchReferencers();
+	void UnloadChunk();
+	void CleanupRedirectors();
+	void SwapBack(FUPRenameJournal& Journal);
+	void MoveInPerforce(FUPPerforceConnection& Connection, FUPRenameJournal& Journal);
+	void RemoveEmptyFolders();
+	void RescanMovedFiles();
+	void ValidatePatchedPackages();
+
+	FUPRenamePlan Plan;
+	bool bApplyPerforceFix;
+
+	/** a self-contained folder, its headers are checked before the directory moves and patched after */
+	struct FFolderMove
+	{
+		int32 FolderIndex = INDEX_NONE;
+		TArray<int32> Entries;
+		int32 MoveStep = INDEX_NONE;
+		int32 PatchStep = INDEX_NONE;
+	};
+	TArray<FFolderMove> FolderMoves;
+	/** per entry, renamed by the folder or file move stage */
+	TArray<bool> FileMoved;
+	/** per entry, moved with its whole folder, its per asset steps are skipped */
+	TArray<bool> FolderMoved;
+	/** per entry, its chunk never ran because the batch was cancelled */
+	TArray<bool> NotRenamed;
+	/** entries the preload -> save stages work on */
+	TArray<int32> ChunkEntries;
+	/** packages the current chunk brought into memory, unloaded when it is done */
+	TSet<FName> PackagesToUnload;
+	/** per chunk entry, resident before the rename stage starts, kept alive until it is done */
+	TArray<TStrongObjectPtr<UObject>> Assets;
+	/** loaded packages referencing the renamed assets, their imports are fixed in memory */
+	TArray<TStrongObjectPtr<UPackage>> Referencers;
+	/** unique set touched by the rename stage: new packages, redirectors and referencers */
+	TSet<UPackage*> DirtyPackages;
+	/** renamed packages with a referencer that could not be loaded, their redirector stays */
+	TSet<FName> PackagesToKeepRedirector;
+	/** old -> new package name of every asset the rename stage moved */
+	TMap<FString, FString> PackageRenames;
+	/** unloaded referencers whose header is patched instead, package name and file */
+	TArray<TPair<FName, FString>> ReferencersToPatch;
+	TArray<TPair<FName, FString>> PatchedReferencers;
+	/** journal step of each entry, per stage */
+	TArray<int32> RenameSteps;
+	TArray<int32> SwapSteps;
+	TArray<int32> MoveSteps;
+};
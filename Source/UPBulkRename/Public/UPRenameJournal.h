@@ -0,0 +1,82 @@
+// Copyright 2024 PufStudio. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class IFileHandle;
+
+namespace EUPJournalStep
+{
+	enum Type
+	{
+		/** engine rename of one asset, object paths */
+		RenameAsset,
+		/** engine rename of a whole folder, folder paths */
+		RenameFolder,
+		/** file moved on disk outside the editor (perforce swap back), file paths */
+		MoveFile,
+		/** p4 move, file paths */
+		P4Move,
+		/** whole directory moved on disk, directory paths */
+		MoveFolder,
+		/** package headers under a moved folder patched to its new paths, content folders */
+		PatchFolder
+	};
+}
+
+/**
+ * Append-only journal of a rename batch in Saved/UPBulkRename.
+ * Every step is written as planned before anything moves, then marked done as it completes.
+ * Done records are synced to disk in batches, so a crash loses at most the last few marks and
+ * replaying those is harmless (each step checks its source still exists).
+ * On the next editor start an unfinished journal can be resumed or rolled back.
+ */
+class UPBULKRENAME_API FUPRenameJournal
+{
+public:
+	~FUPRenameJournal();
+
+	/** Start journaling a batch, fails if the previous batch was never finished */
+	bool Begin(bool bPerforceFix);
+
+	/** Record a planned step, returns its index for Done() */
+	int32 Plan(EUPJournalStep::Type Step, const FString& From, const FString& To);
+
+	/** Mark a planned step completed */
+	void Done(int32 StepIndex);
+
+	/** Mark a planned step as not needed, it is neither resumed nor rolled back */
+	void Skip(int32 StepIndex);
+
+	/** Force everything written so far to disk */
+	void Sync();
+
+	/** The batch finished, the journal is removed */
+	void End();
+
+	static FString GetJournalPath();
+	static bool HasUnfinishedBatch();
+
+	/** Ask whether to resume or roll back an unfinished batch left by a crash */
+	static void RecoverUnfinishedBatch();
+
+private:
+	struct FStep
+	{
+		EUPJournalStep::Type Type;
+		FString From;
+		FString To;
+		bool bDone = false;
+		bool bSkipped = false;
+	};
+	static bool ReadJournal(TArray<FStep>& OutSteps, bool& bOutPerforceFix);
+	static void Resume(const TArray<FStep>& Steps, bool bPerforceFix);
+	static void Rollback(const TArray<FStep>& Steps, bool bPerforceFix);
+
+	void Append(const FString& Line);
+
+	TUniquePtr<IFileHandle> Handle;
+	int32 NumSteps = 0;
+	int32 DoneSinceSync = 0;
+};
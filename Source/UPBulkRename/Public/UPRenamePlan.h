@@ -0,0 +1,48 @@
+// Copyright 2024 PufStudio. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/** One asset moved by a rename batch */
+struct FUPRenameEntry
+{
+	/** standard object path, /Game/Dir/Asset.Asset */
+	FString OldObjectPath;
+	FString NewObjectPath;
+	/** package files on disk, resolved before anything moves */
+	FString OldFilename;
+	FString NewFilename;
+	/** nothing references it and it is not loaded, the file can be moved without loading the asset */
+	bool bMoveFileOnly = false;
+
+	FString GetOldPackageName() const;
+	FString GetNewPackageName() const;
+};
+
+/**
+ * Everything a rename batch moves, computed once from the original listing.
+ * Checkout, swap back and p4 move all read this table, nothing is paired by listing order
+ * and the registry is not enumerated again after the move.
+ */
+class UPBULKRENAME_API FUPRenamePlan
+{
+public:
+	/** Assets renamed one by one, old -> new object path */
+	static FUPRenamePlan MakeForAssets(const TArray<TPair<FString, FString>>& AssetPaths);
+
+	/** Folders renamed, every asset keeps its relative path under the new folder */
+	static FUPRenamePlan MakeForFolders(const TArray<TPair<FString, FString>>& FolderPaths);
+
+	bool IsEmpty() const { return Entries.IsEmpty(); }
+
+	/** Files p4 has to open for edit: every moved package plus its referencers and dependencies */
+	TArray<FString> CollectFilesToEdit() const;
+
+	TArray<FUPRenameEntry> Entries;
+	/** old -> new folder, only filled for folder renames */
+	TArray<TPair<FString, FString>> Folders;
+
+private:
+	void AddEntry(const FString& OldObjectPath, FString&& NewObjectPath);
+};
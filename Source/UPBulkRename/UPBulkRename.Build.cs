@@ -45,7 +45,8 @@ public class UPBulkRename : ModuleRules
 				"SlateCore", 
 				"Blutility", 
 				"EditorScriptingUtilities",
-				"SourceControl"
+				"SourceControl",
+				"AssetTools"
 				// ... add private dependencies that you statically link with here ...	
 			}
 			);